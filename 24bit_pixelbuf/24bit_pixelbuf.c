@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "../capture.h"
+
 #define WIDTH 320
 #define HEIGHT 200
 #define ZOOM 2
@@ -25,6 +27,17 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
 }
 
+// F12 - снимок экрана, F11 - начать/остановить запись видео
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    if (action != GLFW_PRESS) return;
+    if (key == GLFW_KEY_F12) {
+        capture_screenshot("screenshot.png");
+    } else if (key == GLFW_KEY_F11) {
+        if (capture_recording()) capture_stop();
+        else capture_start("capture.y4m", CAPTURE_Y4M, 60);
+    }
+}
+
 void processInput(GLFWwindow *window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, 1);
@@ -44,6 +57,7 @@ int main(void) {
 
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    glfwSetKeyCallback(window, keyCallback);
     glfwSwapInterval(0);
 
     if (glewInit() != GLEW_OK) {
@@ -51,6 +65,7 @@ int main(void) {
         return -1;
     }
 
+    capture_init();
     initPixels(0);
     int i = 0;
 
@@ -61,6 +76,7 @@ int main(void) {
         // Отрисовка пикселей
         glPixelZoom(ZOOM, ZOOM);
         glDrawPixels(WIDTH, HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+        capture_frame(0, 0, WIDTH * ZOOM, HEIGHT * ZOOM);
 
         glfwSwapBuffers(window);
         glfwWaitEventsTimeout(1.0 / 60);
@@ -68,6 +84,7 @@ int main(void) {
         initPixels(++i);
     }
 
+    capture_shutdown();
     glfwTerminate();
     return 0;
 }
@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pixfmt.h"
+#include "image.h"
+#include "imgcache.h"
+#include "atlas.h"
+
+typedef struct AtlasFree {
+  int x, y, w, h;
+  struct AtlasFree *next;
+} AtlasFree;
+
+static void reset_page(Atlas *atlas, AtlasPage *p) {
+  AtlasFree *f;
+
+  while ((f = p->free)) {
+    p->free = f->next;
+    free(f);
+  }
+  p->sky[0].x = p->sky[0].y = 0;
+  p->sky[0].w = atlas->width;
+  p->skyCount = 1;
+  p->count = 0;
+}
+
+static int add_page(Atlas *atlas) {
+  AtlasPage *p = &atlas->page[atlas->pageCount];
+
+  if (atlas->pageCount == ATLAS_MAX_PAGES) return 0;
+  memset(p, 0, sizeof(AtlasPage));
+  p->pixels = pix_alloc(atlas->width, atlas->height, &p->stride);
+  p->sky = malloc(sizeof(AtlasSkyline) * (atlas->width + 1));
+  if (!p->pixels || !p->sky) {
+    pix_free(p->pixels);
+    free(p->sky);
+    return 0;
+  }
+  memset(p->pixels, 0, (size_t)p->stride * atlas->height);
+  p->dirtyX0 = p->dirtyY0 = 0; // Первая загрузка - вся страница
+  p->dirtyX1 = atlas->width;
+  p->dirtyY1 = atlas->height;
+  reset_page(atlas, p);
+  atlas->pageCount++;
+  return 1;
+}
+
+Atlas *atlas_create(int width, int height, int padding, GLenum filter) {
+  Atlas *atlas = calloc(1, sizeof(Atlas));
+
+  if (!atlas) return NULL;
+  atlas->width = width;
+  atlas->height = height;
+  atlas->padding = padding;
+  atlas->filter = filter;
+  return atlas;
+}
+
+void atlas_destroy(Atlas *atlas) {
+  AtlasImage *im;
+
+  if (!atlas) return;
+  while ((im = atlas->images)) {
+    atlas->images = im->next;
+    free(im);
+  }
+  for (int i = 0; i < atlas->pageCount; i++) {
+    AtlasPage *p = &atlas->page[i];
+    reset_page(atlas, p);
+    if (p->texture) glDeleteTextures(1, &p->texture);
+    pix_free(p->pixels);
+    free(p->sky);
+  }
+  free(atlas);
+}
+
+/* Высота, на которой встанет прямоугольник шириной w, если его левый
+   край совпадает с началом участка i; -1, если не помещается */
+static int sky_fit(Atlas *atlas, AtlasPage *p, int i, int w, int h) {
+  int x = p->sky[i].x, y = 0;
+
+  if (x + w > atlas->width) return -1;
+  for (int left = w; left > 0; left -= p->sky[i].w, i++) {
+    if (p->sky[i].y > y) y = p->sky[i].y;
+    if (y + h > atlas->height) return -1;
+  }
+  return y;
+}
+
+// Поднимает линию горизонта над новым прямоугольником, начинающимся с участка i
+static void sky_add(AtlasPage *p, int i, int y, int w, int h) {
+  int x = p->sky[i].x;
+
+  memmove(&p->sky[i + 1], &p->sky[i], sizeof(AtlasSkyline) * (p->skyCount - i));
+  p->sky[i].x = x;
+  p->sky[i].y = y + h;
+  p->sky[i].w = w;
+  p->skyCount++;
+
+  // Укоротить или убрать участки, оказавшиеся под новым
+  for (int j = i + 1; j < p->skyCount; ) {
+    int cut = x + w - p->sky[j].x;
+    if (cut <= 0) break;
+    if (cut < p->sky[j].w) {
+      p->sky[j].x += cut;
+      p->sky[j].w -= cut;
+      break;
+    }
+    memmove(&p->sky[j], &p->sky[j + 1], sizeof(AtlasSkyline) * (p->skyCount - j - 1));
+    p->skyCount--;
+  }
+
+  // Слить соседние участки одной высоты
+  for (int j = 0; j + 1 < p->skyCount; ) {
+    if (p->sky[j].y == p->sky[j + 1].y) {
+      p->sky[j].w += p->sky[j + 1].w;
+      memmove(&p->sky[j + 1], &p->sky[j + 2], sizeof(AtlasSkyline) * (p->skyCount - j - 2));
+      p->skyCount--;
+    } else {
+      j++;
+    }
+  }
+}
+
+static int place_skyline(Atlas *atlas, AtlasPage *p, int w, int h, int *x, int *y) {
+  int best = -1, bestTop = 0, bestW = 0, bestY = 0;
+
+  for (int i = 0; i < p->skyCount; i++) {
+    int top, fy = sky_fit(atlas, p, i, w, h);
+    if (fy < 0) continue;
+    top = fy + h;
+    if (best < 0 || top < bestTop || (top == bestTop && p->sky[i].w < bestW)) {
+      best = i;
+      bestTop = top;
+      bestW = p->sky[i].w;
+      bestY = fy;
+    }
+  }
+  if (best < 0) return 0;
+  *x = p->sky[best].x;
+  *y = bestY;
+  sky_add(p, best, bestY, w, h);
+  return 1;
+}
+
+// Занять наименьшее подходящее освобождённое место; остаток делится на два
+static int place_free(AtlasPage *p, int w, int h, int *x, int *y) {
+  AtlasFree **best = NULL, *f;
+
+  for (AtlasFree **q = &p->free; *q; q = &(*q)->next) {
+    if ((*q)->w >= w && (*q)->h >= h
+        && (!best || (*q)->w * (*q)->h < (*best)->w * (*best)->h)) {
+      best = q;
+    }
+  }
+  if (!best) return 0;
+  f = *best;
+  *best = f->next;
+  *x = f->x;
+  *y = f->y;
+
+  if (f->h > h) { // Снизу - на всю ширину
+    AtlasFree *b = malloc(sizeof(AtlasFree));
+    if (b) {
+      b->x = f->x;
+      b->y = f->y + h;
+      b->w = f->w;
+      b->h = f->h - h;
+      b->next = p->free;
+      p->free = b;
+    }
+  }
+  if (f->w > w) { // Справа - на высоту картинки
+    f->x += w;
+    f->w -= w;
+    f->h = h;
+    f->next = p->free;
+    p->free = f;
+  } else {
+    free(f);
+  }
+  return 1;
+}
+
+static void mark_dirty(AtlasPage *p, int x, int y, int w, int h) {
+  if (p->dirtyX1 <= p->dirtyX0) {
+    p->dirtyX0 = x;
+    p->dirtyY0 = y;
+    p->dirtyX1 = x + w;
+    p->dirtyY1 = y + h;
+    return;
+  }
+  if (x < p->dirtyX0) p->dirtyX0 = x;
+  if (y < p->dirtyY0) p->dirtyY0 = y;
+  if (x + w > p->dirtyX1) p->dirtyX1 = x + w;
+  if (y + h > p->dirtyY1) p->dirtyY1 = y + h;
+}
+
+// Копирует картинку в место (x, y) страницы и заполняет поле её краями
+static void blit(Atlas *atlas, AtlasPage *p, int x, int y,
+    const unsigned char *pixels, int stride, int w, int h) {
+  int pad = atlas->padding;
+
+  for (int row = -pad; row < h + pad; row++) {
+    const unsigned char *s = pixels + (size_t)(row < 0 ? 0 : row >= h ? h - 1 : row) * stride;
+    unsigned char *d = p->pixels + (size_t)(y + row) * p->stride + (size_t)x * PIX_BPP;
+    memcpy(d, s, (size_t)w * PIX_BPP);
+    for (int i = 1; i <= pad; i++) {
+      memcpy(d - i * PIX_BPP, s, PIX_BPP);
+      memcpy(d + (w + i - 1) * PIX_BPP, s + (w - 1) * PIX_BPP, PIX_BPP);
+    }
+  }
+}
+
+AtlasImage *atlas_insert(Atlas *atlas, const unsigned char *pixels, int stride,
+    int width, int height) {
+  int sw = width + 2 * atlas->padding, sh = height + 2 * atlas->padding;
+  int x, y, i;
+  AtlasImage *im;
+
+  if (width <= 0 || height <= 0 || sw > atlas->width || sh > atlas->height) return NULL;
+  for (i = 0; ; i++) {
+    if (i == atlas->pageCount && !add_page(atlas)) return NULL;
+    if (place_free(&atlas->page[i], sw, sh, &x, &y)) break;
+    if (place_skyline(atlas, &atlas->page[i], sw, sh, &x, &y)) break;
+  }
+
+  im = malloc(sizeof(AtlasImage));
+  if (!im) return NULL;
+  x += atlas->padding;
+  y += atlas->padding;
+  im->page = i;
+  im->x = x;
+  im->y = y;
+  im->width = width;
+  im->height = height;
+  im->u0 = (float)x / atlas->width;
+  im->v0 = (float)y / atlas->height;
+  im->u1 = (float)(x + width) / atlas->width;
+  im->v1 = (float)(y + height) / atlas->height;
+  im->slotW = sw;
+  im->slotH = sh;
+  im->next = atlas->images;
+  atlas->images = im;
+
+  blit(atlas, &atlas->page[i], x, y, pixels, stride, width, height);
+  mark_dirty(&atlas->page[i], x - atlas->padding, y - atlas->padding, sw, sh);
+  atlas->page[i].count++;
+  return im;
+}
+
+static unsigned char *decode_dest(void *user, int width, int height, int *stride) {
+  unsigned char **pixels = user;
+  *pixels = pix_alloc(width, height, stride);
+  return *pixels;
+}
+
+AtlasImage *atlas_load(Atlas *atlas, const char *filename) {
+  CacheSource src;
+  unsigned char *pixels = NULL;
+  int w, h, stride = 0;
+  AtlasImage *im = NULL;
+
+  if (!cache_source_open(filename, &src)) {
+    printf("Error loading image '%s'\n", filename);
+    return NULL;
+  }
+  if (img_decode(src.data, src.size, decode_dest, &pixels, &w, &h)) {
+    stride = pix_stride(w);
+    im = atlas_insert(atlas, pixels, stride, w, h);
+    if (!im) printf("Image '%s' does not fit into the atlas\n", filename);
+  } else {
+    printf("Error loading image '%s': %s\n", filename, img_failure_reason());
+  }
+  pix_free(pixels);
+  cache_source_close(&src);
+  return im;
+}
+
+void atlas_evict(Atlas *atlas, AtlasImage *im) {
+  AtlasPage *p;
+  AtlasImage **q = &atlas->images;
+  AtlasFree *f;
+
+  if (!im) return;
+  while (*q != im) q = &(*q)->next;
+  *q = im->next;
+  p = &atlas->page[im->page];
+  if (--p->count == 0) {
+    reset_page(atlas, p); // Страница пуста - упаковка начинается заново
+  } else if ((f = malloc(sizeof(AtlasFree)))) {
+    f->x = im->x - atlas->padding;
+    f->y = im->y - atlas->padding;
+    f->w = im->slotW;
+    f->h = im->slotH;
+    f->next = p->free;
+    p->free = f;
+  }
+  free(im);
+}
+
+void atlas_flush(Atlas *atlas) {
+  for (int i = 0; i < atlas->pageCount; i++) {
+    AtlasPage *p = &atlas->page[i];
+    if (p->dirtyX1 <= p->dirtyX0) continue;
+    if (!p->texture) {
+      p->texture = pix_create_texture(atlas->width, atlas->height, p->pixels, p->stride);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, atlas->filter);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, atlas->filter);
+    } else {
+      pix_upload(p->texture, p->dirtyX0, p->dirtyY0, p->dirtyX1 - p->dirtyX0,
+          p->dirtyY1 - p->dirtyY0, p->pixels, p->stride);
+    }
+    p->dirtyX0 = p->dirtyY0 = p->dirtyX1 = p->dirtyY1 = 0;
+  }
+}
+
+GLuint atlas_texture(Atlas *atlas, int page) {
+  return page < atlas->pageCount ? atlas->page[page].texture : 0;
+}
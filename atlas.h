@@ -0,0 +1,66 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <GL/glew.h>
+
+/* Атлас мелких изображений (курсоры, значки, спрайты): картинки
+   упаковываются в несколько больших общих текстур, и у каждой есть
+   свой прямоугольник текстурных координат. Весь экран значков тогда
+   рисуется с одной привязкой текстуры.
+
+   Упаковка - skyline (нижний левый угол). Освобождённые места
+   запоминаются и занимаются новыми картинками подходящего размера,
+   а опустевшая страница сбрасывается целиком. Вокруг каждой картинки
+   оставляется поле padding пикселей, заполненное продолжением её
+   краёв, чтобы линейная фильтрация и mip не подмешивали соседей. */
+
+#define ATLAS_MAX_PAGES 8
+
+typedef struct AtlasImage {
+  int page; // Номер страницы (текстуры) атласа
+  int x, y, width, height; // Прямоугольник картинки без поля, в пикселях
+  float u0, v0, u1, v1; // Он же в текстурных координатах
+
+  // Внутреннее состояние атласа
+  int slotW, slotH; // Место вместе с полем
+  struct AtlasImage *next;
+} AtlasImage;
+
+typedef struct AtlasSkyline { int x, y, w; } AtlasSkyline;
+
+typedef struct AtlasPage {
+  GLuint texture; // Создаётся при первом atlas_flush
+  unsigned char *pixels; // Копия страницы в памяти (BGRA)
+  int stride;
+  int count; // Картинок на странице
+  AtlasSkyline *sky;
+  int skyCount;
+  struct AtlasFree *free; // Освобождённые места
+  int dirtyX0, dirtyY0, dirtyX1, dirtyY1; // Ещё не загружено в GL
+} AtlasPage;
+
+typedef struct Atlas {
+  int width, height, padding;
+  GLenum filter;
+  AtlasPage page[ATLAS_MAX_PAGES];
+  int pageCount;
+  AtlasImage *images;
+} Atlas;
+
+Atlas *atlas_create(int width, int height, int padding, GLenum filter);
+void atlas_destroy(Atlas *atlas);
+
+/* Кладёт в атлас картинку BGRA (формат pixfmt) с шагом строки stride.
+   Загрузка в GL откладывается до atlas_flush. NULL, если картинка
+   больше страницы или все страницы заняты. */
+AtlasImage *atlas_insert(Atlas *atlas, const unsigned char *pixels, int stride,
+    int width, int height);
+// Декодирует файл и кладёт его в атлас
+AtlasImage *atlas_load(Atlas *atlas, const char *filename);
+void atlas_evict(Atlas *atlas, AtlasImage *image);
+
+// Загружает в GL изменённые части страниц (нужен контекст)
+void atlas_flush(Atlas *atlas);
+GLuint atlas_texture(Atlas *atlas, int page);
+
+#endif
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../display.h"
+#include "../compositor.h"
+
+/* Перетаскивание верхнего вьюера над стопкой других: сборка всего
+   кадра заново и загрузка целиком против compositor.h (COMP_CPU и
+   COMP_GPU). ./compose [вьюеров] [кадров] */
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define VW 480
+#define VH 360
+
+static void draw_viewer(Viewer *v, int n) {
+  for (int y = 0; y < v->height; y++) {
+    unsigned int *row = (unsigned int *)(v->pixels + (size_t)y * v->stride);
+    for (int x = 0; x < v->width; x++) row[x] = 0xFF000000 | (n * 0x3A5F17 + (x / 8 ^ y / 8) * 0x010101);
+  }
+  viewer_damage(v, (DisplayRect){ 0, 0, v->width, v->height });
+}
+
+static Compositor *open_stack(Display *d, int mode, int count) {
+  Compositor *c = comp_create(d, mode, 0xFF406080);
+
+  for (int i = 0; i < count; i++) {
+    Viewer *v = comp_open(c, i * 97 % (WIDTH - VW), i * 61 % (HEIGHT - VH), VW, VH);
+    draw_viewer(v, i);
+  }
+  comp_update(c);
+  return c;
+}
+
+static void drag(Compositor *c, int i) {
+  Viewer *top = c->viewers;
+
+  while (top->next) top = top->next;
+  comp_move(c, top, (i * 7) % (WIDTH - VW), 100 + (i * 3) % (HEIGHT - VH - 100), VW, VH);
+}
+
+// Весь кадр заново: все вьюеры снизу вверх
+static void compose_all(Compositor *c) {
+  Display *d = c->display;
+  DisplayRect all = { 0, 0, WIDTH, HEIGHT };
+
+  for (int y = 0; y < HEIGHT; y++) {
+    unsigned int *row = (unsigned int *)(d->pixels + (size_t)y * d->stride);
+    for (int x = 0; x < WIDTH; x++) row[x] = c->background;
+  }
+  for (Viewer *v = c->viewers; v; v = v->next) {
+    int x0 = v->x < 0 ? 0 : v->x, x1 = v->x + v->width > WIDTH ? WIDTH : v->x + v->width;
+    if (x1 <= x0) continue;
+    for (int y = 0; y < v->height; y++) {
+      if (v->y + y < 0 || v->y + y >= HEIGHT) continue;
+      memcpy(d->pixels + (size_t)(v->y + y) * d->stride + x0 * 4,
+          v->pixels + (size_t)y * v->stride + (x0 - v->x) * 4, (size_t)(x1 - x0) * 4);
+    }
+  }
+  Flush(d, &all, 1);
+}
+
+static double run(Compositor *c, int frames, int naive) {
+  double start;
+
+  glFinish();
+  start = glfwGetTime();
+  for (int i = 0; i < frames; i++) {
+    drag(c, i);
+    if (naive) compose_all(c);
+    else comp_update(c);
+  }
+  glFinish();
+  return (glfwGetTime() - start) / frames;
+}
+
+int main(int argc, char **argv) {
+  int count = argc > 1 ? atoi(argv[1]) : 12;
+  int frames = argc > 2 ? atoi(argv[2]) : 600;
+  Display *d;
+  Compositor *c;
+  double all, cpu, gpu;
+
+  if (count <= 0 || frames <= 0) return 1;
+  d = OpenDisplay(WIDTH, HEIGHT, DISPLAY_HIDDEN);
+  if (!d) return 1;
+
+  c = open_stack(d, COMP_CPU, count);
+  all = run(c, frames, 1);
+  cpu = run(c, frames, 0);
+  comp_destroy(c);
+
+  c = open_stack(d, COMP_GPU, count);
+  gpu = run(c, frames, 0);
+  comp_destroy(c);
+
+  printf("%d вьюеров %dx%d, мс/кадр: весь кадр %.3f, COMP_CPU %.3f, COMP_GPU %.3f\n",
+      count, VW, VH, all * 1000, cpu * 1000, gpu * 1000);
+  Close(d);
+  return 0;
+}
@@ -0,0 +1,67 @@
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STBI_ONLY_JPEG
+#define STB_IMAGE_IMPLEMENTATION
+#include "../stb_image.h"
+
+/* Проверка ядер AVX2 в stb_image: каждый JPEG из images/ декодируется
+   с AVX2, с SSE2 и без SIMD, результаты должны совпадать до байта.
+   Ещё раз - полосами в обратном порядке (stbi_set_parallel_thread):
+   полоса, пишущая за конец своих строк, портит уже готовую соседнюю.
+   ./jpegsimd [файлы...] */
+
+static const char *names[] = { "C", "SSE2", "AVX2", "полосы" };
+
+static void reverse(stbi_job_func *func, void *task, int count) {
+  for (int i = count - 1; i >= 0; i--) func(task, i);
+}
+
+static int check(const char *path) {
+  stbi_uc *out[4];
+  int w[4], h[4], ok = 1;
+
+  for (int comp = 3; comp <= 4; comp++) {
+    for (int level = 0; level < 4; level++) {
+      int n;
+      stbi_set_jpeg_simd(level < 3 ? level : 2);
+      stbi_set_parallel_thread(level < 3 ? NULL : reverse);
+      out[level] = stbi_load(path, &w[level], &h[level], &n, comp);
+      stbi_set_parallel_thread(NULL);
+      if (!out[level]) {
+        printf("%s: %s\n", path, stbi_failure_reason());
+        return 0;
+      }
+    }
+    for (int level = 0; level < 4; level++) {
+      size_t size = (size_t)w[2] * h[2] * comp, diff = 0;
+      if (level == 2) continue;
+      if (w[level] != w[2] || h[level] != h[2]) diff = size;
+      else for (size_t i = 0; i < size; i++) diff += out[level][i] != out[2][i];
+      printf("%s, %d канала: AVX2 и %s - %s", path, comp, names[level], diff ? "РАЗЛИЧАЮТСЯ" : "совпадают");
+      if (diff) printf(" (%zu байт)", diff);
+      printf("\n");
+      if (diff) ok = 0;
+    }
+    for (int level = 0; level < 4; level++) stbi_image_free(out[level]);
+  }
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  glob_t g = { 0 };
+  int ok = 1;
+
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++) ok &= check(argv[i]);
+  } else {
+    glob("../images/*.jpg", 0, NULL, &g);
+    for (size_t i = 0; i < g.gl_pathc; i++) ok &= check(g.gl_pathv[i]);
+    if (g.gl_pathc == 0) printf("Нет файлов ../images/*.jpg\n");
+    globfree(&g);
+  }
+  if (!__builtin_cpu_supports("avx2")) printf("Процессор без AVX2: проверен только SSE2\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../display.h"
+#include "../remote.h"
+
+/* Воспроизведение записанного сеанса (record.h) как нагрузки: кадры
+   декодируются в кадр Display и проходят обычный путь Flush - загрузку
+   прямоугольников, отрисовку и вывод, в скрытом окне; прокрутки идут
+   через ScrollRect, как у записанной программы. Печатает время
+   декодирования и вывода (Flush и ScrollRect) на кадр.
+   ./replay файл [-max] - с записанной скоростью или как можно быстрее */
+
+static double scrollTime, scrollPixels; // Вывод из scroll внутри remote_read
+static long scrollFrames;
+
+// Принятое до прокрутки выводится, как его вывела программа перед ScrollRect
+static void scroll(void *ctx, const DisplayRect *rects, int count, DisplayRect dst, int srcX, int srcY) {
+  Display *d = ctx;
+  DisplayRect r;
+  int dx = dst.x - srcX, dy = dst.y - srcY;
+  double t = glfwGetTime();
+
+  if (count >= 0) {
+    if (count == 0) scrollPixels += (double)d->width * d->height;
+    for (int i = 0; i < count; i++) scrollPixels += (double)rects[i].w * rects[i].h;
+    Flush(d, rects, count);
+    scrollFrames++;
+  }
+  // Прямоугольник, внутри которого dst сдвигается из источника
+  r.x = dx > 0 ? srcX : dst.x;
+  r.y = dy > 0 ? srcY : dst.y;
+  r.w = dst.w + (dx > 0 ? dx : -dx);
+  r.h = dst.h + (dy > 0 ? dy : -dy);
+  ScrollRect(d, &r, dx, dy);
+  glFinish();
+  scrollTime += glfwGetTime() - t;
+}
+
+int main(int argc, char **argv) {
+  RemoteConn *c;
+  RemoteMessage m;
+  DisplayRect rects[64];
+  Display *d;
+  double start, t, t0, out, decode = 0, flush = 0, flushMax = 0, pixels = 0;
+  int fd, type, fast = argc > 2 && strcmp(argv[2], "-max") == 0;
+  long frames = 0, events = 0;
+
+  if (argc < 2) {
+    fprintf(stderr, "replay файл [-max]\n");
+    return 1;
+  }
+  fd = open(argv[1], O_RDONLY);
+  c = remote_open(fd, 0, 0);
+  if (!c) {
+    perror(argv[1]);
+    return 1;
+  }
+  d = OpenDisplay(c->width, c->height, DISPLAY_HIDDEN);
+  if (!d) return 1;
+  c->scroll = scroll;
+  c->scrollCtx = d;
+
+  start = glfwGetTime();
+  t0 = start;
+  while ((type = remote_read(c, &m, d->pixels, d->stride, rects, 64)) > 0) {
+    if (type == REMOTE_MSG_TIME) {
+      // Ожидание до времени записи
+      while (!fast && (t = glfwGetTime() - start) < m.time * 1e-6) usleep((unsigned)((m.time * 1e-6 - t) * 1e6));
+    } else if (type == REMOTE_MSG_EVENT) {
+      events++;
+    } else if (type == REMOTE_MSG_FRAME && m.count == 1 && rects[0].w == 0) {
+      /* Кадр из одних прокруток (за ScrollRect не было Flush): сдвиг уже
+         сделан, а вывода у программы не было */
+      decode += glfwGetTime() - t0 - scrollTime;
+      flush += scrollTime;
+      pixels += scrollPixels;
+      frames += scrollFrames;
+      scrollTime = scrollPixels = 0;
+      scrollFrames = 0;
+    } else if (type == REMOTE_MSG_FRAME) {
+      t = glfwGetTime();
+      decode += t - t0 - scrollTime;
+      out = scrollTime;
+      pixels += scrollPixels;
+      frames += scrollFrames;
+      scrollTime = scrollPixels = 0;
+      scrollFrames = 0;
+      if (m.count == 0) pixels += (double)c->width * c->height;
+      for (int i = 0; i < m.count; i++) pixels += (double)rects[i].w * rects[i].h;
+      Flush(d, rects, m.count);
+      glFinish(); // Загрузка и вывод - в замер этого кадра
+      t0 = glfwGetTime();
+      out += t0 - t;
+      flush += out;
+      if (out > flushMax) flushMax = out;
+      frames++;
+      continue;
+    }
+    t0 = glfwGetTime();
+  }
+
+  t = glfwGetTime() - start;
+  printf("%ld кадров, %ld событий за %.3f с (%.1f кадров/с)\n", frames, events, t, frames / t);
+  if (frames > 0) {
+    printf("декодирование %.3f мс/кадр, Flush %.3f мс/кадр (худший %.3f), %.0f пикселей/кадр\n",
+        decode * 1000 / frames, flush * 1000 / frames, flushMax * 1000, pixels / frames);
+  }
+  remote_close(c);
+  Close(d);
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../display.h"
+
+/* Прокрутка полноэкранного текста на строку: ScrollRect и загрузка
+   одной открывшейся строки против сдвига всего кадра и его полной
+   загрузки. ./scroll [высота строки] [кадров] */
+
+#define WIDTH 1920
+#define HEIGHT 1080
+
+// Новая "строка текста" внизу кадра
+static void draw_line(Display *d, int line, int n) {
+  for (int y = HEIGHT - line; y < HEIGHT; y++) {
+    unsigned int *row = (unsigned int *)(d->pixels + (size_t)y * d->stride);
+    for (int x = 0; x < WIDTH; x++) row[x] = (x / 9 + n) % 3 && (y % line) < line - 4 ? 0xFF202020 : 0xFFF0F0E0;
+  }
+}
+
+int main(int argc, char **argv) {
+  int line = argc > 1 ? atoi(argv[1]) : 16;
+  int frames = argc > 2 ? atoi(argv[2]) : 600;
+  DisplayRect all = { 0, 0, WIDTH, HEIGHT }, strip = { 0, HEIGHT - line, WIDTH, line };
+  Display *d;
+  double start, full, scroll;
+
+  if (line <= 0 || line >= HEIGHT || frames <= 0) return 1;
+  d = OpenDisplay(WIDTH, HEIGHT, DISPLAY_HIDDEN);
+  if (!d) return 1;
+  Flush(d, NULL, 0);
+
+  // Как раньше: сдвиг в памяти и загрузка всего кадра
+  glFinish();
+  start = glfwGetTime();
+  for (int i = 0; i < frames; i++) {
+    memmove(d->pixels, d->pixels + (size_t)line * d->stride, (size_t)(HEIGHT - line) * d->stride);
+    draw_line(d, line, i);
+    Flush(d, &all, 1);
+  }
+  glFinish();
+  full = (glfwGetTime() - start) / frames;
+
+  // ScrollRect: сдвиг в памяти и на GPU, загрузка одной строки
+  start = glfwGetTime();
+  for (int i = 0; i < frames; i++) {
+    ScrollRect(d, &all, 0, -line);
+    draw_line(d, line, i);
+    Flush(d, &strip, 1);
+  }
+  glFinish();
+  scroll = (glfwGetTime() - start) / frames;
+
+  printf("Весь кадр: %.3f мс/кадр, ScrollRect: %.3f мс/кадр (строка %d пикселей)\n",
+      full * 1000, scroll * 1000, line);
+  Close(d);
+  return 0;
+}
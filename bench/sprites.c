@@ -0,0 +1,108 @@
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "../pixfmt.h"
+#include "../sprites.h"
+
+/* Замер пакетной отрисовки: N движущихся спрайтов из нескольких
+   текстур и слоёв, часть обрезается прямоугольником.
+   ./sprites [число спрайтов] [кадров] */
+
+#define WIDTH 1280
+#define HEIGHT 720
+#define TEXTURES 4
+
+typedef struct Item {
+  float x, y, dx, dy, size;
+  int texture, layer;
+  unsigned int color;
+} Item;
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 10000;
+  int frames = argc > 2 ? atoi(argv[2]) : 300;
+  GLuint textures[TEXTURES];
+  double start, cpu = 0;
+  int f;
+  Item *items;
+
+  if (n <= 0 || frames <= 0 || !glfwInit()) return 1;
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  GLFWwindow *win = glfwCreateWindow(WIDTH, HEIGHT, "Sprites", NULL, NULL);
+  if (!win) {
+    glfwTerminate();
+    return 1;
+  }
+  glfwMakeContextCurrent(win);
+  glewExperimental = GL_TRUE;
+  if (glewInit() != GLEW_OK) return 1;
+  glfwSwapInterval(0);
+  pix_init_format();
+  sprite_init(NULL);
+
+  // Клетчатые текстуры 16x16 разных цветов
+  for (int t = 0; t < TEXTURES; t++) {
+    unsigned int pixels[16 * 16];
+    for (int i = 0; i < 16 * 16; i++) {
+      pixels[i] = ((i / 16 + i) / 4 & 1) ? 0xFF000000u | 0x3F3F3Fu * (t + 1) : 0xFFFFFFFFu;
+    }
+    textures[t] = pix_create_texture(16, 16, pixels, 16 * PIX_BPP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  }
+
+  items = malloc(sizeof(Item) * n);
+  srand(1);
+  for (int i = 0; i < n; i++) {
+    items[i].x = rand() % WIDTH;
+    items[i].y = rand() % HEIGHT;
+    items[i].dx = (rand() % 200 - 100) / 50.0f;
+    items[i].dy = (rand() % 200 - 100) / 50.0f;
+    items[i].size = 4 + rand() % 28;
+    items[i].texture = rand() % TEXTURES;
+    items[i].layer = rand() % 3;
+    items[i].color = 0x80000000u | (rand() & 0xFFFFFF);
+  }
+
+  glViewport(0, 0, WIDTH, HEIGHT);
+  glFinish();
+  start = glfwGetTime();
+  for (f = 0; f < frames && !glfwWindowShouldClose(win); f++) {
+    double t0 = glfwGetTime();
+    glClearColor(0, 0, 0, 1);
+    glClear(GL_COLOR_BUFFER_BIT);
+    sprite_begin(WIDTH, HEIGHT);
+    for (int i = 0; i < n; i++) {
+      Item *it = &items[i];
+      it->x += it->dx;
+      it->y += it->dy;
+      if (it->x < 0 || it->x > WIDTH) it->dx = -it->dx;
+      if (it->y < 0 || it->y > HEIGHT) it->dy = -it->dy;
+      sprite_layer(it->layer);
+      // Каждый восьмой - в обрезанной рамке посередине
+      if (i % 8 == 0) sprite_clip(WIDTH / 4, HEIGHT / 4, WIDTH / 2, HEIGHT / 2);
+      sprite_draw(textures[it->texture], it->x, it->y, it->size, it->size, 0, 0, 1, 1, it->color);
+      if (i % 8 == 0) sprite_noclip();
+    }
+    sprite_end();
+    cpu += glfwGetTime() - t0;
+    glfwSwapBuffers(win);
+    glfwPollEvents();
+  }
+  glFinish();
+  double total = glfwGetTime() - start;
+  if (f == 0) return 1;
+  printf("%d sprites: %.3f ms/frame (%.3f ms CPU), %.1f M sprites/s\n",
+      n, total * 1000 / f, cpu * 1000 / f, (double)n * f / total / 1e6);
+
+  free(items);
+  glDeleteTextures(TEXTURES, textures);
+  sprite_shutdown();
+  glfwTerminate();
+  return 0;
+}
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../display.h"
+#include "../compositor.h"
+#include "../store.h"
+
+/* Много вьюеров с текстом в одной стопке, наверх по очереди
+   поднимается один из них: память хранилищ, степень сжатия, время
+   распаковки и доля обращений без распаковки (store.h).
+   ./stores [вьюеров] [бюджет, КБ] */
+
+#define WIDTH 1280
+#define HEIGHT 1024
+
+// "Текст": строки коротких штрихов на светлом фоне
+static void draw_text(Viewer *v, void *ctx) {
+  unsigned char *pixels = v->pixels;
+  int seed = v->x / 8; // Свой текст у каждого, тот же при перерисовке
+
+  for (int y = 0; y < v->height; y++) {
+    unsigned int *row = (unsigned int *)(pixels + (size_t)y * v->stride);
+    for (int x = 0; x < v->width; x++) {
+      int on = y % 16 < 12 && ((x / 7 * 31 + y / 16 * 17 + seed) % 5) && (x * 3 + y) % 7 < 2;
+      row[x] = on ? 0xFF101010 : 0xFFF4F0E8;
+    }
+  }
+  viewer_damage(v, (DisplayRect){ 0, 0, v->width, v->height });
+}
+
+int main(int argc, char **argv) {
+  int count = argc > 1 ? atoi(argv[1]) : 40;
+  size_t budget = (argc > 2 ? atol(argv[2]) : 49152) * 1024;
+  Display *d;
+  Compositor *c;
+  StoreManager *m;
+  StoreStats s;
+  Viewer **v;
+
+  if (count <= 0) return 1;
+  v = malloc(count * sizeof(Viewer *));
+  d = OpenDisplay(WIDTH, HEIGHT, DISPLAY_HIDDEN);
+  if (!v || !d) return 1;
+  c = comp_create(d, COMP_CPU, 0xFF406080);
+  m = store_create(c, budget, 4, draw_text, NULL);
+  if (!c || !m) return 1;
+
+  // Все вьюеры почти во весь экран, как сеансы терминального сервера
+  for (int i = 0; i < count; i++) {
+    v[i] = comp_open(c, i % 8 * 8, i % 8 * 8, WIDTH - 64, HEIGHT - 64);
+    viewer_pixels(v[i]);
+    draw_text(v[i], NULL);
+  }
+  comp_update(c);
+  for (int i = 0; i < count * 4; i++) {
+    comp_raise(c, v[i * 7 % count]);
+    comp_update(c);
+    usleep(5000); // Фоновое сжатие
+  }
+
+  store_stats(m, &s);
+  printf("%d вьюеров %dx%d, бюджет %zu КБ; без сжатия %zu КБ\n", count, WIDTH - 64, HEIGHT - 64,
+      budget / 1024, (size_t)count * (WIDTH - 64) * 4 * (HEIGHT - 64) / 1024);
+  printf("Несжатые: %d, %zu КБ; сжатые: %d, %zu КБ (в %.1f раз); выгружены: %d\n",
+      s.residentCount, s.resident / 1024, s.packedCount, s.packed / 1024,
+      s.packed ? (double)s.packedRaw / s.packed : 0.0, s.evictedCount);
+  printf("Обращения: %llu на месте (%.1f%%), %llu распаковано, %llu нарисовано заново\n",
+      (unsigned long long)s.hits, 100.0 * s.hits / (s.hits + s.unpacks + s.redraws),
+      (unsigned long long)s.unpacks, (unsigned long long)s.redraws);
+  printf("Распаковка: в среднем %.3f мс, не больше %.3f мс\n",
+      s.unpacks ? s.unpackTime / s.unpacks * 1000 : 0.0, s.unpackMax * 1000);
+
+  comp_destroy(c);
+  Close(d);
+  free(v);
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../display.h"
+#include "../atlas.h"
+#include "../font.h"
+#include "../sprites.h"
+
+/* Скорость вывода текста (символов в секунду) на экран 1920x1080:
+   в кадр в памяти в режимах FONT_REPLACE, FONT_PAINT, FONT_INVERT и
+   через GPU из атласа. ./text шрифт.Fnt|шрифт.bdf [повторов] */
+
+#define WIDTH 1920
+#define HEIGHT 1080
+
+static char text[161];
+
+// Экран текста: строки по всей высоте; возвращает число символов
+static long cpu_screen(Font *font, const FontTarget *t, int mode) {
+  long n = 0;
+
+  for (int y = font->ascent; y + font->descent <= HEIGHT; y += font->height) {
+    font_draw(font, t, 0, y, text, 0xFF000000, 0xFFFFFFF0, mode);
+    n += sizeof(text) - 1;
+  }
+  return n;
+}
+
+static long gpu_screen(Font *font) {
+  long n = 0;
+
+  sprite_begin(WIDTH, HEIGHT);
+  for (int y = font->ascent; y + font->descent <= HEIGHT; y += font->height) {
+    font_draw_gpu(font, 0, y, text, 0xFF000000);
+    n += sizeof(text) - 1;
+  }
+  sprite_end();
+  return n;
+}
+
+int main(int argc, char **argv) {
+  static const char *names[] = { "FONT_REPLACE", "FONT_PAINT", "FONT_INVERT" };
+  int repeat = argc > 2 ? atoi(argv[2]) : 100;
+  Display *d;
+  Font *font;
+  Atlas *atlas;
+  FontTarget target;
+  double start, t;
+  long n;
+
+  if (argc < 2 || repeat <= 0) {
+    fprintf(stderr, "text шрифт [повторов]\n");
+    return 1;
+  }
+  font = font_load(argv[1]);
+  if (!font) return 1;
+  for (int i = 0; i < (int)sizeof(text) - 1; i++) text[i] = 33 + i % 94;
+
+  d = OpenDisplay(WIDTH, HEIGHT, DISPLAY_HIDDEN);
+  if (!d) return 1;
+  target = (FontTarget){ d->pixels, d->stride, 0, 0, WIDTH, HEIGHT };
+
+  for (int mode = FONT_REPLACE; mode <= FONT_INVERT; mode++) {
+    n = 0;
+    start = glfwGetTime();
+    for (int i = 0; i < repeat; i++) n += cpu_screen(font, &target, mode);
+    t = glfwGetTime() - start;
+    printf("%-12s %6.1f млн символов/с\n", names[mode], n / t / 1e6);
+  }
+
+  // Вывод на экран: символы из атласа одним пакетом спрайтов
+  atlas = atlas_create(1024, 1024, 1, GL_NEAREST);
+  sprite_init(NULL);
+  if (!font_upload(font, atlas)) fprintf(stderr, "Не все символы поместились в атлас\n");
+  glViewport(0, 0, WIDTH, HEIGHT);
+  gpu_screen(font);
+  glFinish();
+  n = 0;
+  start = glfwGetTime();
+  for (int i = 0; i < repeat; i++) n += gpu_screen(font);
+  glFinish();
+  t = glfwGetTime() - start;
+  printf("%-12s %6.1f млн символов/с\n", "GPU", n / t / 1e6);
+
+  sprite_shutdown();
+  font_free(font);
+  atlas_destroy(atlas);
+  Close(d);
+  return 0;
+}
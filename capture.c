@@ -0,0 +1,464 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/glew.h>
+
+#include "capture.h"
+
+#define SLOTS 3 // Буферов PBO: чтение кадра, ожидание GPU, отображение
+#define MAX_QUEUED 16 // Кадров в очереди записи, остальные пропускаются
+
+// Запись в один файл или серию PNG; принадлежит потоку записи после capture_start
+typedef struct Stream {
+  FILE *file;
+  char *path;
+  int format, fps;
+  int width, height; // Размер первого кадра, остальные должны совпадать
+  int frames;
+} Stream;
+
+enum { JOB_FRAME, JOB_STILL, JOB_CLOSE };
+
+typedef struct Job {
+  int kind;
+  Stream *stream;
+  char *filename; // JOB_STILL
+  unsigned char *pixels; // BGRA, строки снизу вверх, как отдаёт glReadPixels
+  int width, height;
+  struct Job *next;
+} Job;
+
+typedef struct Slot {
+  GLuint pbo;
+  size_t size;
+  GLsync fence; // Не NULL - в буфер читается кадр
+  int width, height;
+  Stream *stream;
+  char *still;
+} Slot;
+
+static Slot slots[SLOTS];
+static int nextSlot;
+static Stream *recording;
+static char *pendingStill;
+static int dropped;
+
+static pthread_t thread;
+static int running;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static Job *jobs, *jobsTail;
+static int queued;
+static int quit;
+
+// --- PNG ---
+
+static uint32_t crcTable[256];
+
+static void crc_init(void) {
+  for (uint32_t n = 0; n < 256; n++) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    crcTable[n] = c;
+  }
+}
+
+static uint32_t crc_update(uint32_t crc, const unsigned char *p, size_t len) {
+  for (size_t i = 0; i < len; i++) crc = crcTable[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+  return crc;
+}
+
+static void put32(unsigned char *p, uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+static int write_chunk(FILE *f, const char *type, const unsigned char *data, uint32_t len) {
+  unsigned char hdr[8], tail[4];
+  uint32_t crc;
+
+  put32(hdr, len);
+  memcpy(hdr + 4, type, 4);
+  crc = crc_update(0xFFFFFFFFu, hdr + 4, 4);
+  crc = crc_update(crc, data, len) ^ 0xFFFFFFFFu;
+  put32(tail, crc);
+  return fwrite(hdr, 8, 1, f) == 1 && (len == 0 || fwrite(data, len, 1, f) == 1)
+      && fwrite(tail, 4, 1, f) == 1;
+}
+
+/* RGB без сжатия: поток zlib из несжатых блоков deflate по 65535 байт,
+   каждая строка с фильтром 0. Кодирование - одно копирование. */
+static int write_png(const char *filename, const unsigned char *pixels, int w, int h) {
+  static const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+  size_t rowLen = 1 + (size_t)w * 3, rawLen = rowLen * h;
+  size_t blocks = (rawLen + 65534) / 65535;
+  size_t idatLen = 2 + rawLen + 5 * blocks + 4;
+  unsigned char ihdr[13], *idat, *d, *row;
+  uint32_t a = 1, b = 0; // Adler-32
+  size_t left, pos;
+  FILE *f;
+  int ok;
+
+  if (idatLen > 0x7FFFFFFF) return 0;
+  idat = malloc(idatLen);
+  row = malloc(rowLen);
+  if (!idat || !row) {
+    free(idat);
+    free(row);
+    return 0;
+  }
+  d = idat;
+  *d++ = 0x78; // zlib: deflate, окно 32 КБ, без словаря
+  *d++ = 0x01;
+  left = 0;
+  pos = 0;
+  for (int y = 0; y < h; y++) {
+    const unsigned char *s = pixels + (size_t)(h - 1 - y) * w * 4; // Снизу вверх -> сверху вниз
+    row[0] = 0;
+    for (int x = 0; x < w; x++) {
+      row[1 + x * 3] = s[x * 4 + 2];
+      row[2 + x * 3] = s[x * 4 + 1];
+      row[3 + x * 3] = s[x * 4];
+    }
+    for (size_t i = 0; i < rowLen; i++) {
+      a += row[i];
+      if (a >= 65521) a -= 65521;
+      b += a;
+      if (b >= 65521) b -= 65521;
+    }
+    for (size_t i = 0; i < rowLen; ) {
+      size_t n;
+      if (left == 0) { // Заголовок следующего несжатого блока
+        left = rawLen - pos < 65535 ? rawLen - pos : 65535;
+        *d++ = pos + left == rawLen; // BFINAL у последнего
+        *d++ = left & 0xFF;
+        *d++ = left >> 8;
+        *d++ = ~left & 0xFF;
+        *d++ = (~left >> 8) & 0xFF;
+      }
+      n = rowLen - i < left ? rowLen - i : left;
+      memcpy(d, row + i, n);
+      d += n;
+      i += n;
+      pos += n;
+      left -= n;
+    }
+  }
+  put32(d, b << 16 | a);
+  free(row);
+
+  put32(ihdr, w);
+  put32(ihdr + 4, h);
+  ihdr[8] = 8; // Бит на канал
+  ihdr[9] = 2; // RGB
+  ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+  f = fopen(filename, "wb");
+  if (!f) {
+    free(idat);
+    return 0;
+  }
+  ok = fwrite(signature, 8, 1, f) == 1
+      && write_chunk(f, "IHDR", ihdr, 13)
+      && write_chunk(f, "IDAT", idat, idatLen)
+      && write_chunk(f, "IEND", NULL, 0);
+  free(idat);
+  return fclose(f) == 0 && ok;
+}
+
+// --- Y4M и сырой поток ---
+
+// BT.601 с полным диапазоном (C420jpeg): цветность усредняется по квадратам 2x2
+static int write_y4m_frame(FILE *f, const unsigned char *pixels, int w, int h) {
+  int cw = w / 2, ch = h / 2;
+  unsigned char *plane = malloc((size_t)w * h + 2 * (size_t)cw * ch);
+  unsigned char *py = plane, *pu = plane + (size_t)w * h, *pv = pu + (size_t)cw * ch;
+  int ok;
+
+  if (!plane) return 0;
+  for (int y = 0; y < h; y++) {
+    const unsigned char *s = pixels + (size_t)(h - 1 - y) * w * 4;
+    for (int x = 0; x < w; x++) {
+      int b = s[x * 4], g = s[x * 4 + 1], r = s[x * 4 + 2];
+      py[(size_t)y * w + x] = (77 * r + 150 * g + 29 * b + 128) >> 8;
+    }
+  }
+  for (int y = 0; y < ch; y++) {
+    const unsigned char *s0 = pixels + (size_t)(h - 1 - 2 * y) * w * 4, *s1 = s0 - (size_t)w * 4;
+    for (int x = 0; x < cw; x++) {
+      const unsigned char *a = s0 + x * 8, *c = s1 + x * 8;
+      int b = a[0] + a[4] + c[0] + c[4], g = a[1] + a[5] + c[1] + c[5], r = a[2] + a[6] + c[2] + c[6];
+      int u = (-43 * r - 85 * g + 128 * b + 512 * 256 + 512) >> 10;
+      int v = (128 * r - 107 * g - 21 * b + 512 * 256 + 512) >> 10;
+      // Чисто синий (u) или красный (v) с округлением даёт 256
+      pu[(size_t)y * cw + x] = u > 255 ? 255 : u;
+      pv[(size_t)y * cw + x] = v > 255 ? 255 : v;
+    }
+  }
+  ok = fputs("FRAME\n", f) >= 0 && fwrite(plane, (size_t)w * h + 2 * (size_t)cw * ch, 1, f) == 1;
+  free(plane);
+  return ok;
+}
+
+static void write_frame(Stream *s, Job *j) {
+  char name[1100];
+
+  if (s->frames == 0) {
+    s->width = j->width;
+    s->height = j->height;
+    if (s->format == CAPTURE_Y4M) {
+      fprintf(s->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+          s->width & ~1, s->height & ~1, s->fps);
+    }
+  } else if (j->width != s->width || j->height != s->height) {
+    return; // Размер окна поменялся: в поток такие кадры не пишутся
+  }
+
+  switch (s->format) {
+  case CAPTURE_PNG:
+    snprintf(name, sizeof(name), s->path, s->frames);
+    if (!write_png(name, j->pixels, j->width, j->height)) printf("Can't write '%s'\n", name);
+    break;
+  case CAPTURE_Y4M:
+    // Для 4:2:0 размеры чётные: лишний столбец и строка (сверху) отбрасываются
+    if (s->width & 1) {
+      for (int y = 0; y < j->height; y++) {
+        memmove(j->pixels + (size_t)y * (j->width - 1) * 4, j->pixels + (size_t)y * j->width * 4,
+            (size_t)(j->width - 1) * 4);
+      }
+    }
+    write_y4m_frame(s->file, j->pixels, s->width & ~1, s->height & ~1);
+    break;
+  case CAPTURE_RAW: // BGRA сверху вниз
+    for (int y = j->height - 1; y >= 0; y--) {
+      fwrite(j->pixels + (size_t)y * j->width * 4, (size_t)j->width * 4, 1, s->file);
+    }
+    break;
+  }
+  s->frames++;
+}
+
+static void *writer(void *arg) {
+  Job *j;
+
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    while (!jobs && !quit) pthread_cond_wait(&wake, &lock);
+    if (!jobs) break;
+    j = jobs;
+    jobs = j->next;
+    if (!jobs) jobsTail = NULL;
+    if (j->kind == JOB_FRAME) queued--;
+    pthread_mutex_unlock(&lock);
+
+    if (j->kind == JOB_STILL) {
+      if (!write_png(j->filename, j->pixels, j->width, j->height)) {
+        printf("Can't write screenshot '%s'\n", j->filename);
+      }
+      free(j->filename);
+    } else if (j->kind == JOB_FRAME) {
+      write_frame(j->stream, j);
+    } else {
+      if (j->stream->file) fclose(j->stream->file);
+      free(j->stream->path);
+      free(j->stream);
+    }
+    free(j->pixels);
+    free(j);
+
+    pthread_mutex_lock(&lock);
+  }
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+/* Кладёт задание в очередь; кадры видео сверх MAX_QUEUED отбрасываются,
+   снимки экрана - никогда: их просили явно и по одному */
+static void submit(Job *j) {
+  pthread_mutex_lock(&lock);
+  if (j->kind == JOB_FRAME && queued >= MAX_QUEUED) {
+    pthread_mutex_unlock(&lock);
+    dropped++;
+    free(j->filename);
+    free(j->pixels);
+    free(j);
+    return;
+  }
+  if (j->kind == JOB_FRAME) queued++;
+  j->next = NULL;
+  if (jobsTail) jobsTail->next = j; else jobs = j;
+  jobsTail = j;
+  pthread_cond_signal(&wake);
+  pthread_mutex_unlock(&lock);
+}
+
+static Job *new_job(int kind, const unsigned char *pixels, int w, int h) {
+  Job *j = calloc(1, sizeof(Job));
+
+  if (!j) return NULL;
+  j->kind = kind;
+  j->width = w;
+  j->height = h;
+  if (pixels) {
+    j->pixels = malloc((size_t)w * h * 4);
+    if (!j->pixels) {
+      free(j);
+      return NULL;
+    }
+    memcpy(j->pixels, pixels, (size_t)w * h * 4);
+  }
+  return j;
+}
+
+// --- Чтение из PBO ---
+
+// Забирает кадр из буфера (wait: ждать GPU) и отдаёт потоку записи
+static int harvest(Slot *s, int wait) {
+  const unsigned char *p;
+  Job *j;
+
+  if (!s->fence) return 1;
+  if (glClientWaitSync(s->fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+      wait ? 1000000000 : 0) == GL_TIMEOUT_EXPIRED) {
+    return 0;
+  }
+  glDeleteSync(s->fence);
+  s->fence = NULL;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+  p = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (size_t)s->width * s->height * 4, GL_MAP_READ_BIT);
+  if (p) {
+    if (s->stream && (j = new_job(JOB_FRAME, p, s->width, s->height))) {
+      j->stream = s->stream;
+      submit(j);
+    }
+    if (s->still) {
+      if ((j = new_job(JOB_STILL, p, s->width, s->height))) {
+        j->filename = s->still;
+        s->still = NULL;
+        submit(j);
+      } else {
+        printf("Can't write screenshot '%s'\n", s->still);
+      }
+    }
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  } else if (s->still) {
+    printf("Can't write screenshot '%s'\n", s->still);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  free(s->still);
+  s->still = NULL;
+  s->stream = NULL;
+  return 1;
+}
+
+void capture_init(void) {
+  crc_init();
+  memset(slots, 0, sizeof(slots));
+  for (int i = 0; i < SLOTS; i++) glGenBuffers(1, &slots[i].pbo);
+  nextSlot = 0;
+  quit = 0;
+  dropped = 0;
+  running = pthread_create(&thread, NULL, writer, NULL) == 0;
+}
+
+void capture_shutdown(void) {
+  capture_stop();
+  for (int i = 0; i < SLOTS; i++) harvest(&slots[(nextSlot + i) % SLOTS], 1);
+  free(pendingStill);
+  pendingStill = NULL;
+  if (running) {
+    pthread_mutex_lock(&lock);
+    quit = 1;
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&lock);
+    pthread_join(thread, NULL);
+    running = 0;
+  }
+  for (int i = 0; i < SLOTS; i++) glDeleteBuffers(1, &slots[i].pbo);
+  if (dropped) printf("Capture: %d frames dropped\n", dropped);
+}
+
+int capture_start(const char *path, int format, int fps) {
+  Stream *s;
+
+  capture_stop();
+  if (!running) return 0;
+  s = calloc(1, sizeof(Stream));
+  if (!s) return 0;
+  s->format = format;
+  s->fps = fps > 0 ? fps : 60;
+  s->path = strdup(path);
+  if (format != CAPTURE_PNG) {
+    s->file = fopen(path, "wb");
+    if (!s->file) {
+      printf("Can't create '%s'\n", path);
+      free(s->path);
+      free(s);
+      return 0;
+    }
+  }
+  recording = s;
+  return 1;
+}
+
+void capture_stop(void) {
+  Job *j;
+
+  if (!recording) return;
+  // Кадры, ещё лежащие в PBO, дописываются до закрытия файла
+  for (int i = 0; i < SLOTS; i++) {
+    Slot *s = &slots[(nextSlot + i) % SLOTS];
+    if (s->stream == recording) harvest(s, 1);
+  }
+  j = new_job(JOB_CLOSE, NULL, 0, 0);
+  if (j) {
+    j->stream = recording;
+    submit(j);
+  }
+  recording = NULL;
+}
+
+int capture_recording(void) {
+  return recording != NULL;
+}
+
+void capture_screenshot(const char *filename) {
+  free(pendingStill);
+  pendingStill = strdup(filename);
+}
+
+void capture_frame(int x, int y, int width, int height) {
+  Slot *s;
+  size_t size = (size_t)width * height * 4;
+
+  if (!running) return;
+  // Кадры, которые GPU уже прочитал, забираются без ожидания
+  for (int i = 0; i < SLOTS; i++) {
+    if (!harvest(&slots[(nextSlot + i) % SLOTS], 0)) break; // Следующие тем более не готовы
+  }
+  if ((!recording && !pendingStill) || width <= 0 || height <= 0) return;
+
+  s = &slots[nextSlot];
+  harvest(s, 1); // Все буферы заняты: самый старый кадр ждать всё равно придётся
+  nextSlot = (nextSlot + 1) % SLOTS;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+  if (s->size != size) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    s->size = size;
+  }
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(x, y, width, height, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  s->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  s->width = width;
+  s->height = height;
+  s->stream = recording;
+  s->still = pendingStill;
+  pendingStill = NULL;
+}
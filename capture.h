@@ -0,0 +1,34 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+/* Снимки экрана и запись видео без остановки отрисовки. glReadPixels
+   пишет кадр в один из нескольких буферов упаковки (PBO); буфер
+   отображается в память на следующих кадрах, когда GPU его уже
+   заполнил, и копия уходит потоку записи. Поток пишет PNG (без сжатия,
+   deflate из несжатых блоков) или поток Y4M (YUV 4:2:0) / сырой BGRA.
+   Если поток записи не успевает, лишние кадры пропускаются и
+   подсчитываются, но отрисовка не ждёт. */
+
+enum { CAPTURE_PNG, CAPTURE_Y4M, CAPTURE_RAW };
+
+// Нужен текущий GL-контекст
+void capture_init(void);
+// Дописывает всё начатое и останавливает поток записи
+void capture_shutdown(void);
+
+/* Запись каждого кадра. CAPTURE_PNG: path - шаблон printf с номером
+   кадра ("shot-%05d.png"); CAPTURE_Y4M и CAPTURE_RAW: один файл.
+   fps записывается в заголовок Y4M. Возвращает 1 при успехе. */
+int capture_start(const char *path, int format, int fps);
+void capture_stop(void);
+int capture_recording(void);
+
+// Снимок следующего захваченного кадра в файл PNG
+void capture_screenshot(const char *filename);
+
+/* Захват прямоугольника заднего буфера; вызывается после отрисовки
+   кадра, до glfwSwapBuffers. Ничего не делает, если не идёт запись и
+   не заказан снимок (кроме сбора уже прочитанных кадров). */
+void capture_frame(int x, int y, int width, int height);
+
+#endif
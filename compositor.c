@@ -0,0 +1,375 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pixfmt.h"
+#include "sprites.h"
+#include "store.h"
+#include "compositor.h"
+
+#define MAX_SCREEN_DAMAGE 64 // Больше - один охватывающий прямоугольник
+
+// --- Прямоугольники ---
+
+// Набор непересекающихся прямоугольников
+typedef struct Region {
+  DisplayRect *rects;
+  int count, cap;
+} Region;
+
+static int intersect(DisplayRect a, DisplayRect b, DisplayRect *out) {
+  int x0 = a.x > b.x ? a.x : b.x, y0 = a.y > b.y ? a.y : b.y;
+  int x1 = a.x + a.w < b.x + b.w ? a.x + a.w : b.x + b.w;
+  int y1 = a.y + a.h < b.y + b.h ? a.y + a.h : b.y + b.h;
+
+  if (x1 <= x0 || y1 <= y0) return 0;
+  if (out) *out = (DisplayRect){ x0, y0, x1 - x0, y1 - y0 };
+  return 1;
+}
+
+static void region_add(Region *r, DisplayRect a) {
+  DisplayRect *p;
+
+  if (a.w <= 0 || a.h <= 0) return;
+  if (r->count == r->cap) {
+    p = realloc(r->rects, (r->cap ? r->cap * 2 : 16) * sizeof(DisplayRect));
+    if (!p) return;
+    r->rects = p;
+    r->cap = r->cap ? r->cap * 2 : 16;
+  }
+  r->rects[r->count++] = a;
+}
+
+// Вычитает cut из каждого прямоугольника: остаются до 4 частей
+static void region_subtract(Region *r, DisplayRect cut) {
+  int n = r->count;
+
+  for (int i = 0; i < n; i++) {
+    DisplayRect a = r->rects[i], m;
+    if (!intersect(a, cut, &m)) continue;
+    // На место a - пустой, части добавляются в конец
+    r->rects[i].w = 0;
+    region_add(r, (DisplayRect){ a.x, a.y, a.w, m.y - a.y }); // Сверху
+    region_add(r, (DisplayRect){ a.x, m.y + m.h, a.w, a.y + a.h - m.y - m.h }); // Снизу
+    region_add(r, (DisplayRect){ a.x, m.y, m.x - a.x, m.h }); // Слева
+    region_add(r, (DisplayRect){ m.x + m.w, m.y, a.x + a.w - m.x - m.w, m.h }); // Справа
+  }
+  // Удаление пустых
+  n = 0;
+  for (int i = 0; i < r->count; i++) {
+    if (r->rects[i].w > 0) r->rects[n++] = r->rects[i];
+  }
+  r->count = n;
+}
+
+static DisplayRect viewer_rect(const Viewer *v) {
+  return (DisplayRect){ v->x, v->y, v->width, v->height };
+}
+
+// --- Вьюеры ---
+
+static void fill(unsigned char *pixels, int stride, DisplayRect r, uint32_t color) {
+  for (int y = r.y; y < r.y + r.h; y++) {
+    uint32_t *row = (uint32_t *)(pixels + (size_t)y * stride);
+    for (int x = r.x; x < r.x + r.w; x++) row[x] = color;
+  }
+}
+
+// Место на экране, которое надо собрать заново
+static void screen_damage(Compositor *c, DisplayRect r) {
+  DisplayRect *p;
+
+  if (c->damageCount == c->damageCap) {
+    p = realloc(c->damage, (c->damageCap ? c->damageCap * 2 : 16) * sizeof(DisplayRect));
+    if (!p) return;
+    c->damage = p;
+    c->damageCap = c->damageCap ? c->damageCap * 2 : 16;
+  }
+  c->damage[c->damageCount++] = r;
+}
+
+unsigned char *viewer_pixels(Viewer *v) {
+  return v->owner->stores ? store_load(v->owner->stores, v) : v->pixels;
+}
+
+void viewer_damage(Viewer *v, DisplayRect r) {
+  if (v->damageCount < 0) return;
+  if (!intersect(r, (DisplayRect){ 0, 0, v->width, v->height }, &r)) return;
+  if (v->damageCount == VIEWER_DAMAGE) v->damageCount = -1;
+  else v->damage[v->damageCount++] = r;
+}
+
+Compositor *comp_create(Display *display, int mode, uint32_t background) {
+  Compositor *c = calloc(1, sizeof(Compositor));
+
+  if (!c) return NULL;
+  c->display = display;
+  c->mode = mode;
+  c->background = background;
+  if (mode == COMP_GPU) sprite_init(NULL);
+  screen_damage(c, (DisplayRect){ 0, 0, display->width, display->height });
+  return c;
+}
+
+static void free_viewer(Viewer *v) {
+  if (v->texture) glDeleteTextures(1, &v->texture);
+  pix_free(v->pixels);
+  free(v->packed);
+  free(v);
+}
+
+void comp_destroy(Compositor *c) {
+  Viewer *v;
+
+  if (!c) return;
+  store_destroy(c->stores);
+  while ((v = c->viewers)) {
+    c->viewers = v->next;
+    free_viewer(v);
+  }
+  if (c->mode == COMP_GPU) sprite_shutdown();
+  free(c->damage);
+  free(c);
+}
+
+Viewer *comp_open(Compositor *c, int x, int y, int width, int height) {
+  Viewer *v, **p;
+
+  if (width <= 0 || height <= 0) return NULL;
+  v = calloc(1, sizeof(Viewer));
+  if (!v) return NULL;
+  v->pixels = pix_alloc(width, height, &v->stride);
+  if (!v->pixels) {
+    free(v);
+    return NULL;
+  }
+  v->x = x;
+  v->y = y;
+  v->width = width;
+  v->height = height;
+  fill(v->pixels, v->stride, (DisplayRect){ 0, 0, width, height }, c->background);
+  v->damageCount = -1;
+  v->owner = c;
+  for (p = &c->viewers; *p; p = &(*p)->next);
+  *p = v;
+  if (c->stores) store_load(c->stores, v); // Отметка обращения
+  return v;
+}
+
+static void unlink_viewer(Compositor *c, Viewer *v) {
+  Viewer **p;
+
+  for (p = &c->viewers; *p && *p != v; p = &(*p)->next);
+  if (*p) *p = v->next;
+  v->next = NULL;
+}
+
+void comp_close(Compositor *c, Viewer *v) {
+  if (c->stores) store_forget(c->stores, v);
+  unlink_viewer(c, v);
+  screen_damage(c, viewer_rect(v));
+  free_viewer(v);
+}
+
+void comp_raise(Compositor *c, Viewer *v) {
+  Viewer **p;
+
+  if (!v->next) return;
+  unlink_viewer(c, v);
+  for (p = &c->viewers; *p; p = &(*p)->next);
+  *p = v;
+  v->damageCount = -1; // Мог быть закрыт другими
+}
+
+void comp_move(Compositor *c, Viewer *v, int x, int y, int width, int height) {
+  unsigned char *pixels, *old;
+  int stride, w, h;
+
+  if (width <= 0 || height <= 0) return;
+  screen_damage(c, viewer_rect(v));
+  if (width != v->width || height != v->height) {
+    old = viewer_pixels(v);
+    pixels = pix_alloc(width, height, &stride);
+    if (!pixels || !old) {
+      pix_free(pixels);
+      return;
+    }
+    fill(pixels, stride, (DisplayRect){ 0, 0, width, height }, c->background);
+    w = width < v->width ? width : v->width;
+    h = height < v->height ? height : v->height;
+    for (int row = 0; row < h; row++) {
+      memcpy(pixels + (size_t)row * stride, old + (size_t)row * v->stride, (size_t)w * 4);
+    }
+    pix_free(v->pixels);
+    v->pixels = pixels;
+    v->stride = stride;
+    v->width = width;
+    v->height = height;
+    if (v->texture) {
+      glDeleteTextures(1, &v->texture);
+      v->texture = 0;
+    }
+  }
+  v->x = x;
+  v->y = y;
+  v->damageCount = -1;
+}
+
+// --- Сборка ---
+
+// Видимость вьюеров: вычитание всех вьюеров выше из его части на экране
+static void find_occluded(Compositor *c) {
+  DisplayRect screen = { 0, 0, c->display->width, c->display->height }, vr;
+  Region r = { 0 };
+
+  for (Viewer *v = c->viewers; v; v = v->next) {
+    r.count = 0;
+    if (intersect(viewer_rect(v), screen, &vr)) region_add(&r, vr);
+    for (Viewer *u = v->next; u && r.count > 0; u = u->next) region_subtract(&r, viewer_rect(u));
+    v->occluded = r.count == 0;
+  }
+  free(r.rects);
+}
+
+// Изменённые места экрана без пересечений
+static void collect_damage(Compositor *c, Region *out) {
+  DisplayRect screen = { 0, 0, c->display->width, c->display->height }, r, box;
+  Region piece = { 0 };
+
+  for (int i = 0; i < c->damageCount; i++) {
+    if (!intersect(c->damage[i], screen, &r)) continue;
+    piece.count = 0;
+    region_add(&piece, r);
+    for (int k = 0; k < out->count && piece.count > 0; k++) region_subtract(&piece, out->rects[k]);
+    for (int k = 0; k < piece.count; k++) region_add(out, piece.rects[k]);
+  }
+  free(piece.rects);
+
+  if (out->count > MAX_SCREEN_DAMAGE) {
+    box = out->rects[0];
+    for (int i = 1; i < out->count; i++) {
+      r = out->rects[i];
+      int x1 = box.x + box.w > r.x + r.w ? box.x + box.w : r.x + r.w;
+      int y1 = box.y + box.h > r.y + r.h ? box.y + box.h : r.y + r.h;
+      box.x = box.x < r.x ? box.x : r.x;
+      box.y = box.y < r.y ? box.y : r.y;
+      box.w = x1 - box.x;
+      box.h = y1 - box.y;
+    }
+    out->rects[0] = box;
+    out->count = 1;
+  }
+}
+
+// Сборка прямоугольника экрана: сверху вниз, каждый пиксель - один раз
+static void compose_cpu(Compositor *c, Viewer **stack, int count, DisplayRect r, Region *left) {
+  Display *d = c->display;
+  DisplayRect part;
+
+  left->count = 0;
+  region_add(left, r);
+  for (int i = count - 1; i >= 0 && left->count > 0; i--) {
+    Viewer *v = stack[i];
+    DisplayRect vr = viewer_rect(v);
+    unsigned char *pixels = NULL;
+    for (int k = 0; k < left->count; k++) {
+      if (!intersect(left->rects[k], vr, &part)) continue;
+      if (!pixels && !(pixels = viewer_pixels(v))) break;
+      for (int y = 0; y < part.h; y++) {
+        memcpy(d->pixels + (size_t)(part.y + y) * d->stride + part.x * 4,
+            pixels + (size_t)(part.y - v->y + y) * v->stride + (part.x - v->x) * 4, (size_t)part.w * 4);
+      }
+    }
+    region_subtract(left, vr);
+  }
+  for (int k = 0; k < left->count; k++) fill(d->pixels, d->stride, left->rects[k], c->background);
+}
+
+static void present_gpu(Compositor *c) {
+  Display *d = c->display;
+  int layer = 0;
+
+  glfwMakeContextCurrent(d->win);
+  glClearColor(((c->background >> 16) & 255) / 255.0f, ((c->background >> 8) & 255) / 255.0f,
+      (c->background & 255) / 255.0f, 1.0f);
+  glViewport(0, 0, d->winW, d->winH);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glViewport(d->viewX, d->viewY, d->viewW, d->viewH);
+  sprite_begin(d->width, d->height);
+  for (Viewer *v = c->viewers; v; v = v->next, layer++) {
+    unsigned char *pixels = NULL;
+
+    if (v->occluded) continue;
+    // Изменения вьюера - в его текстуру; без них буфер не нужен
+    if (!v->texture || v->damageCount != 0) pixels = viewer_pixels(v);
+    if (pixels) {
+      if (!v->texture) {
+        v->texture = pix_create_texture(v->width, v->height, pixels, v->stride);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      } else if (v->damageCount < 0) {
+        pix_upload(v->texture, 0, 0, v->width, v->height, pixels, v->stride);
+      } else {
+        for (int i = 0; i < v->damageCount; i++) {
+          DisplayRect r = v->damage[i];
+          pix_upload(v->texture, r.x, r.y, r.w, r.h, pixels, v->stride);
+        }
+      }
+      v->damageCount = 0;
+    }
+    // Буфер не восстановился: старая текстура, если есть, а изменения - в следующий раз
+    if (!v->texture) continue;
+    sprite_layer(layer);
+    sprite_draw(v->texture, v->x, v->y, v->width, v->height, 0, 0, 1, 1, SPRITE_WHITE);
+  }
+  sprite_end();
+  glfwSwapBuffers(d->win);
+}
+
+int comp_update(Compositor *c) {
+  Region damage = { 0 }, left = { 0 };
+  Viewer **stack;
+  int count = 0, changed;
+
+  find_occluded(c);
+  if (c->stores) store_tick(c->stores);
+  for (Viewer *v = c->viewers; v; v = v->next) {
+    count++;
+    if (v->occluded || v->damageCount == 0) continue;
+    if (v->damageCount < 0) {
+      screen_damage(c, viewer_rect(v));
+    } else {
+      for (int i = 0; i < v->damageCount; i++) {
+        DisplayRect r = v->damage[i];
+        screen_damage(c, (DisplayRect){ v->x + r.x, v->y + r.y, r.w, r.h });
+      }
+    }
+  }
+  changed = c->damageCount > 0;
+  if (!changed) return 0;
+
+  if (c->mode == COMP_GPU) {
+    present_gpu(c);
+    c->damageCount = 0;
+    return 1;
+  }
+
+  // Только видимые вьюеры, снизу вверх
+  stack = malloc((count + 1) * sizeof(Viewer *));
+  if (!stack) return 0;
+  count = 0;
+  for (Viewer *v = c->viewers; v; v = v->next) {
+    if (!v->occluded) stack[count++] = v;
+    v->damageCount = 0;
+  }
+  collect_damage(c, &damage);
+  for (int i = 0; i < damage.count; i++) compose_cpu(c, stack, count, damage.rects[i], &left);
+  // Всё обрезано краями экрана: Flush с count == 0 загрузил бы весь кадр
+  changed = damage.count > 0;
+  if (changed) Flush(c->display, damage.rects, damage.count);
+
+  c->damageCount = 0;
+  free(stack);
+  free(damage.rects);
+  free(left.rects);
+  return changed;
+}
@@ -0,0 +1,78 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <stdint.h>
+
+#include "display.h"
+
+/* Составление экрана из вьюеров (viewers Oberon). У каждого вьюера
+   свой буфер (backing store) в формате pixfmt: вьюер рисует только в
+   него и сообщает изменённые места через viewer_damage. comp_update
+   собирает на экране только изменённое и видимое:
+     - изменения каждого вьюера и места, открывшиеся после перемещения
+       или закрытия вьюеров, сводятся в непересекающиеся прямоугольники;
+     - каждый из них разрезается вьюерами сверху вниз, так что каждый
+       пиксель экрана копируется один раз, из верхнего вьюера, а
+       полностью закрытые вьюеры пропускаются целиком;
+     - что не закрыто ни одним вьюером, заливается фоном.
+   Перемещение вьюера поэтому стоит копии его самого и открывшейся
+   полосы, а не перерисовки всех вьюеров под ним.
+
+   COMP_CPU: сборка в кадр Display и Flush только изменённых мест.
+   COMP_GPU: у вьюера своя текстура, в неё грузятся его изменения, а
+   экран рисуется прямоугольниками вьюеров (sprites.h) снизу вверх. */
+
+enum { COMP_CPU, COMP_GPU };
+
+#define VIEWER_DAMAGE 16 // Больше прямоугольников - изменён весь вьюер
+
+typedef struct Viewer {
+  int x, y, width, height; // Место на экране
+  unsigned char *pixels; // Буфер вьюера
+  int stride;
+  DisplayRect damage[VIEWER_DAMAGE]; // В координатах вьюера
+  int damageCount; // -1 - весь вьюер
+  int occluded; // Не виден: закрыт вьюерами выше или вне экрана (пересчитывается в comp_update)
+  GLuint texture; // COMP_GPU
+  struct Viewer *next; // Следующий, выше
+  struct Compositor *owner;
+  // Хранилище (store.h): при сжатом или выгруженном буфере pixels == NULL
+  int store;
+  unsigned char *packed;
+  size_t packedSize;
+  uint64_t used; // Такт последнего обращения
+} Viewer;
+
+typedef struct Compositor {
+  Display *display;
+  int mode;
+  uint32_t background; // 0xAARRGGBB там, где нет вьюеров
+  Viewer *viewers; // Снизу вверх
+  DisplayRect *damage; // Экран: открывшиеся места
+  int damageCount, damageCap;
+  struct StoreManager *stores; // store.h или NULL
+} Compositor;
+
+Compositor *comp_create(Display *display, int mode, uint32_t background);
+// Закрывает все вьюеры и менеджер хранилищ
+void comp_destroy(Compositor *c);
+
+// Новый вьюер поверх остальных, залитый фоном
+Viewer *comp_open(Compositor *c, int x, int y, int width, int height);
+void comp_close(Compositor *c, Viewer *v);
+/* Перемещение и смена размера. Содержимое сохраняется от левого
+   верхнего угла; новую часть (залитую фоном) вьюер рисует сам. */
+void comp_move(Compositor *c, Viewer *v, int x, int y, int width, int height);
+void comp_raise(Compositor *c, Viewer *v);
+
+/* Буфер вьюера для рисования. С менеджером хранилищ (store.h) буфер
+   может быть сжат или выгружен, поэтому рисовать надо только в то, что
+   вернула эта функция, и брать её заново после comp_update. */
+unsigned char *viewer_pixels(Viewer *v);
+// Вьюер изменил прямоугольник своего буфера
+void viewer_damage(Viewer *v, DisplayRect r);
+
+// Собирает изменённое на экране и выводит кадр; 0, если менять было нечего
+int comp_update(Compositor *c);
+
+#endif
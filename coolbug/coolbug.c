@@ -1,119 +1,35 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "../stb_image.h"
-
-const char* vertexShaderSource = "#version 330 core\n"
-    "layout (location = 0) in vec3 aPos;\n"
-    "layout (location = 1) in vec2 aTexCoord;\n"
-    "out vec2 TexCoord;\n"
-    "void main() {\n"
-    "   gl_Position = vec4(aPos, 1.0);\n"
-    "   TexCoord = aTexCoord;\n"
-    "}\0";
+#include "../pixfmt.h"
+#include "../jobpool.h"
+#include "../loader.h"
+#include "../sprites.h"
+#include "../postfx.h"
+#include "../latency.h"
 
+// Проход постобработки с волной; время передаётся через uniform
 const char* fragmentShaderSource = "#version 330 core\n"
-    "out vec4 FragColor;\n"
     "in vec2 TexCoord;\n"
-    "uniform sampler2D texture1;\n"
+    "uniform sampler2D source;\n"
+    "uniform float time;\n"
+    "out vec4 FragColor;\n"
     "void main() {\n"
     "   vec2 texCoord = TexCoord;\n"
-    "   texCoord.x += sin(texCoord.y * 20.0 + glfwGetTime()) * 0.01;\n"
-    "   FragColor = texture(texture1, texCoord);\n"
+    "   texCoord.x += sin(texCoord.y * 20.0 + time) * 0.01;\n"
+    "   FragColor = texture(source, texCoord);\n"
     "}\0";
 
-GLuint compileShader(GLenum type, const char* source) {
-  // Создание шейдера
-  GLuint shader = glCreateShader(type);
-  glShaderSource(shader, 1, &source, NULL);
-  glCompileShader(shader);
-
-  // Проверка на ошибки компиляции
-  GLint success;
-  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-  if (!success) {
-    char infoLog[512];
-    glGetShaderInfoLog(shader, 512, NULL, infoLog);
-    fprintf(stderr, "Ошибка компиляции шейдера: %s\n", infoLog);
-  }
-
-  return shader;
-}
-
-GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource) {
-  // Компиляция шейдеров
-  GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
-  GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
-
-  // Создание программы и прикрепление шейдеров к ней
-  GLuint shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-  glLinkProgram(shaderProgram);
-
-  // Проверка на ошибки линковки
-  GLint success;
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-  if (!success) {
-    char infoLog[512];
-    glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-    fprintf(stderr, "Ошибка линковки программы: %s\n", infoLog);
-  }
-
-  // Удаление шейдеров после линковки
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
-
-  return shaderProgram;
-}
-
-GLuint loadTexture(const char* filename) {
-  int width, height, channels;
-  unsigned char* data = stbi_load(filename, &width, &height, &channels, 0);
-  if (data == NULL) {
-    printf("Error loading texture '%s'\n", filename);
-    exit(1);
-  }
-
-  GLuint textureID;
-  glGenTextures(1, &textureID);
-  glBindTexture(GL_TEXTURE_2D, textureID);
-
-  // Установка параметров текстуры
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  // Загрузка изображения в текстуру
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-  glGenerateMipmap(GL_TEXTURE_2D);
-
-  // Освобождение памяти и отвязка текстуры
-  stbi_image_free(data);
-  glBindTexture(GL_TEXTURE_2D, 0);
-
-  return textureID;
-}
-
-void drawMovingSquare(GLFWwindow* window, double time, GLuint textureID) {
+void drawMovingSquare(int width, int height, double time, GLuint textureID) {
   float x = (float)sin(time) * 0.5f; // Простая анимация движения
   float y = (float)cos(time) * 0.5f;
 
-  glBindTexture(GL_TEXTURE_2D, textureID); // Привязка текстуры
-  glEnable(GL_TEXTURE_2D); // Включение текстурирования
-
-  glBegin(GL_QUADS);
-    glTexCoord2f(0.0f, 1.0f); glVertex2f(-0.25f + x, -0.4f + y);
-    glTexCoord2f(1.0f, 1.0f); glVertex2f(0.25f + x, -0.4f + y);
-    glTexCoord2f(1.0f, 0.0f); glVertex2f(0.25f + x, 0.4f + y);
-    glTexCoord2f(0.0f, 0.0f); glVertex2f(-0.25f + x, 0.4f + y);
-  glEnd();
-
-  glBindTexture(GL_TEXTURE_2D, 0); // Отвязка текстуры
+  // Квадрат от (-0.25, -0.4) до (0.25, 0.4) со сдвигом (x, y), в пикселях окна
+  sprite_draw(textureID, (0.75f + x) * 0.5f * width, (0.6f - y) * 0.5f * height,
+      0.25f * width, 0.4f * height, 0, 0, 1, 1, SPRITE_WHITE);
 }
 
 int main(void) {
@@ -129,6 +45,9 @@ int main(void) {
   const GLFWvidmode* mode = glfwGetVideoMode(primaryMonitor);
 
   // Создание окна
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   glfwWindowHint(GLFW_DECORATED, GLFW_FALSE); // Окно без рамки
   glfwWindowHint(GLFW_AUTO_ICONIFY, GLFW_FALSE); // Без автосворачивания
   win = glfwCreateWindow(mode->width, mode->height, "Fullscreen", primaryMonitor, NULL);
@@ -147,30 +66,66 @@ int main(void) {
   }
 
   glfwSwapInterval(1);
-
-  // Загрузка текстуры
-  GLuint textureID = loadTexture("../images/man.jpg");
-
-  // Шейдер
-  GLuint shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
+  pix_init_format();
+
+  // Загрузка текстуры в фоне
+  cache_init(NULL, 0);
+  pool_init(0); // Потоки для декодирования одного изображения по частям
+  loader_init(2);
+  // Квадрат занимает меньше половины экрана, полный 1024x1024 не нужен
+  Asset *man = loader_request_scaled("../images/man.jpg", GL_LINEAR, 512, 512);
+
+  // Сцена рисуется в кадр вдвое меньше экрана, волна - на нём, затем растяжение на экран
+  int w, h;
+  glfwGetFramebufferSize(win, &w, &h);
+  sprite_init(NULL);
+  post_init(w / 2, h / 2);
+  GLuint shaderProgram = post_program(fragmentShaderSource);
+  GLint timeLocation = glGetUniformLocation(shaderProgram, "time");
+  post_add_pass(shaderProgram, 1, GL_LINEAR);
+  post_add_pass(0, 0, GL_LINEAR);
+
+  latency_init(2); // Не больше двух кадров в очереди драйвера
 
   // Главный цикл
   int done = 0;
   while (!glfwWindowShouldClose(win)) {
     glfwMakeContextCurrent(win);
 
-    glClearColor(0.1, 0.4, 0.7, 0.0);
+    glfwGetFramebufferSize(win, &w, &h);
+    glViewport(0, 0, w, h);
+    post_resize(w / 2 > 0 ? w / 2 : 1, h / 2 > 0 ? h / 2 : 1);
 
+    double time = glfwGetTime();
+    latency_input();
     glUseProgram(shaderProgram);
+    glUniform1f(timeLocation, (float)time);
 
-    double time = glfwGetTime();
-    drawMovingSquare(win, time, textureID);
+    post_begin();
+    glClearColor(0.1, 0.4, 0.7, 0.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    sprite_begin(w / 2, h / 2);
+    drawMovingSquare(w / 2, h / 2, time, man->texture);
+    sprite_end();
+    post_run(0);
 
     glfwSwapBuffers(win);
+    latency_frame_end();
+    latency_report(5.0);
+    loader_finalize(LOADER_BUDGET);
 
     glfwPollEvents();
   }
 
+  latency_shutdown();
+  while (loader_finalize(LOADER_BUDGET) > 0) glfwWaitEventsTimeout(0.01);
+  loader_free(man);
+  loader_shutdown();
+  pool_shutdown();
+  sprite_shutdown();
+  post_shutdown();
+  glDeleteProgram(shaderProgram);
+
   glfwTerminate();
   return 0;
 }
@@ -0,0 +1,528 @@
+#define _GNU_SOURCE // memfd_create
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "pixfmt.h"
+#include "display.h"
+#include "record.h"
+
+static const char *vertexSource = "#version 330 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 1) in vec2 aTexCoord;\n"
+    "out vec2 TexCoord;\n"
+    "void main() {\n"
+    "  gl_Position = vec4(aPos, 0.0, 1.0);\n"
+    "  TexCoord = aTexCoord;\n"
+    "}\n";
+
+static const char *fragmentSource = "#version 330 core\n"
+    "in vec2 TexCoord;\n"
+    "uniform sampler2D frame;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "  FragColor = vec4(texture(frame, TexCoord).rgb, 1.0);\n"
+    "}\n";
+
+static int openCount; // Открытых окон; glfwTerminate - после последнего
+
+static GLuint compileShader(GLenum type, const char* source) {
+  // Создание шейдера
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+
+  // Проверка на ошибки компиляции
+  GLint success;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  if (!success) {
+    char infoLog[512];
+    glGetShaderInfoLog(shader, 512, NULL, infoLog);
+    fprintf(stderr, "Ошибка компиляции шейдера: %s\n", infoLog);
+  }
+
+  return shader;
+}
+
+GLuint display_program(const char *vertexSource, const char *fragmentSource) {
+  // Компиляция шейдеров
+  GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+  GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+  // Создание программы и прикрепление шейдеров к ней
+  GLuint shaderProgram = glCreateProgram();
+  glAttachShader(shaderProgram, vertexShader);
+  glAttachShader(shaderProgram, fragmentShader);
+  glLinkProgram(shaderProgram);
+
+  // Проверка на ошибки линковки
+  GLint success;
+  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+  if (!success) {
+    char infoLog[512];
+    glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+    fprintf(stderr, "Ошибка линковки программы: %s\n", infoLog);
+  }
+
+  // Удаление шейдеров после линковки
+  glDeleteShader(vertexShader);
+  glDeleteShader(fragmentShader);
+
+  return shaderProgram;
+}
+
+static void init_buffers(Display *d) {
+  // Определение вершин прямоугольника и текстурных координат
+  float vertices[] = {
+    // позиции | текстурные координаты
+     1,  1,      1, 0, // верхний правый угол
+     1, -1,      1, 1, // нижний правый угол
+    -1, -1,      0, 1, // нижний левый угол
+    -1,  1,      0, 0  // верхний левый угол
+  };
+  unsigned int indices[] = {
+    0, 1, 3, // первый треугольник
+    1, 2, 3  // второй треугольник
+  };
+
+  glGenVertexArrays(1, &d->vao);
+  glGenBuffers(1, &d->vbo);
+  glGenBuffers(1, &d->ebo);
+
+  glBindVertexArray(d->vao);
+
+  glBindBuffer(GL_ARRAY_BUFFER, d->vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, d->ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+  // Позиционные атрибуты
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
+  glEnableVertexAttribArray(0);
+
+  // Текстурные атрибуты
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+}
+
+void display_draw_quad(Display *d) {
+  glBindVertexArray(d->vao);
+  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+}
+
+void display_to_frame(Display *d, double x, double y, int *fx, int *fy) {
+  // Окно в координатах экрана, а область вывода - в пикселях буфера кадра
+  int ww, wh;
+  glfwGetWindowSize(d->win, &ww, &wh);
+  if (ww > 0 && wh > 0) {
+    x = x * d->winW / ww;
+    y = y * d->winH / wh;
+  }
+  *fx = d->viewW > 0 ? (int)((x - d->viewX) * d->width / d->viewW) : 0;
+  *fy = d->viewH > 0 ? (int)((y - (d->winH - d->viewY - d->viewH)) * d->height / d->viewH) : 0;
+}
+
+// Очередь событий: последовательные движения мыши сливаются в одно
+static void push_event(Display *d, int type, int x, int y, int key, int action, int mods) {
+  DisplayEvent *e;
+  int next = (d->tail + 1) % DISPLAY_QUEUE;
+
+  if (d->recorder) {
+    // Записываются все события, до слияния движений мыши
+    DisplayEvent r = { type, x, y, key, action, mods };
+    record_event(d->recorder, &r);
+  }
+  if (type == EVENT_MOUSE_MOVE && d->head != d->tail) {
+    e = &d->queue[(d->tail + DISPLAY_QUEUE - 1) % DISPLAY_QUEUE];
+    if (e->type == EVENT_MOUSE_MOVE) {
+      e->x = x;
+      e->y = y;
+      return;
+    }
+  }
+  if (next == d->head) return; // Очередь полна: событие теряется
+  e = &d->queue[d->tail];
+  e->type = type;
+  e->x = x;
+  e->y = y;
+  e->key = key;
+  e->action = action;
+  e->mods = mods;
+  d->tail = next;
+}
+
+static void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+  Display *d = glfwGetWindowUserPointer(window);
+
+  d->winW = width;
+  d->winH = height;
+
+  float aspectRatioSource = (float)d->width / (float)d->height;
+  float aspectRatioWindow = (float)width / (float)height;
+
+  int viewportWidth, viewportHeight;
+  int scale = width / d->width < height / d->height ? width / d->width : height / d->height;
+
+  if (d->flags & DISPLAY_INTEGER_SCALE && scale >= 1) {
+    // Каждый пиксель кадра - ровно scale x scale пикселей экрана
+    viewportWidth = d->width * scale;
+    viewportHeight = d->height * scale;
+  } else if (aspectRatioWindow > aspectRatioSource) {
+    viewportHeight = height;
+    viewportWidth = (int)(height * aspectRatioSource);
+  } else {
+    viewportWidth = width;
+    viewportHeight = (int)(width / aspectRatioSource);
+  }
+
+  int viewportX = (width - viewportWidth) / 2;
+  int viewportY = (height - viewportHeight) / 2;
+
+  // Контекст окна может быть текущим в другом потоке (monitors.h)
+  if (glfwGetCurrentContext() == window) glViewport(viewportX, viewportY, viewportWidth, viewportHeight);
+  d->viewX = viewportX;
+  d->viewY = viewportY;
+  d->viewW = viewportWidth;
+  d->viewH = viewportHeight;
+  push_event(d, EVENT_RESIZE, width, height, 0, 0, 0);
+}
+
+static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  push_event(glfwGetWindowUserPointer(window), EVENT_KEY, 0, 0, key, action, mods);
+}
+
+static void char_callback(GLFWwindow *window, unsigned int ch) {
+  push_event(glfwGetWindowUserPointer(window), EVENT_CHAR, 0, 0, ch, 0, 0);
+}
+
+static void cursor_callback(GLFWwindow *window, double x, double y) {
+  Display *d = glfwGetWindowUserPointer(window);
+  int fx, fy;
+
+  display_to_frame(d, x, y, &fx, &fy);
+  push_event(d, EVENT_MOUSE_MOVE, fx, fy, 0, 0, 0);
+}
+
+static void button_callback(GLFWwindow *window, int button, int action, int mods) {
+  Display *d = glfwGetWindowUserPointer(window);
+  double x, y;
+  int fx, fy;
+
+  glfwGetCursorPos(window, &x, &y);
+  display_to_frame(d, x, y, &fx, &fy);
+  push_event(d, EVENT_MOUSE_BUTTON, fx, fy, button, action, mods);
+}
+
+static void scroll_callback(GLFWwindow *window, double dx, double dy) {
+  push_event(glfwGetWindowUserPointer(window), EVENT_SCROLL, (int)dx, (int)dy, 0, 0, 0);
+}
+
+static void close_callback(GLFWwindow *window) {
+  push_event(glfwGetWindowUserPointer(window), EVENT_CLOSE, 0, 0, 0, 0, 0);
+}
+
+/* Кадр в памяти memfd: его можно передать другому процессу (shm.c)
+   и рисовать в нём оттуда без копирования. Без memfd - обычная память. */
+static unsigned char *alloc_frame(Display *d) {
+  size_t size;
+  void *p;
+
+  d->stride = pix_stride(d->width);
+  size = (size_t)d->stride * d->height;
+  d->fd = memfd_create("obdisplay", MFD_CLOEXEC);
+  if (d->fd >= 0) {
+    p = ftruncate(d->fd, size) ? MAP_FAILED
+        : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, d->fd, 0);
+    if (p != MAP_FAILED) return p;
+    close(d->fd);
+    d->fd = -1;
+  }
+  return pix_alloc(d->width, d->height, &d->stride);
+}
+
+static void free_frame(Display *d) {
+  if (d->fd >= 0) {
+    munmap(d->pixels, (size_t)d->stride * d->height);
+    close(d->fd);
+  } else {
+    pix_free(d->pixels);
+  }
+}
+
+// Лучше ли режим a режима b для кадра width x height
+static int better_mode(const GLFWvidmode *a, const GLFWvidmode *b, int width, int height, int refresh) {
+  const GLFWvidmode *m[2] = { a, b };
+  double score[2];
+  int scale[2];
+
+  for (int i = 0; i < 2; i++) {
+    int sx = m[i]->width / width, sy = m[i]->height / height;
+    scale[i] = sx < sy ? sx : sy;
+    // Поля вокруг кадра, в процентах экрана
+    score[i] = 100.0 - 100.0 * width * scale[i] * height * scale[i] / ((double)m[i]->width * m[i]->height);
+    // Частота ниже, чем у рабочего стола: штраф за каждый Гц
+    if (m[i]->refreshRate < refresh) score[i] += refresh - m[i]->refreshRate;
+    if (m[i]->redBits + m[i]->greenBits + m[i]->blueBits < 24) score[i] += 1000;
+  }
+  if (score[0] < score[1] - 0.5 || score[0] > score[1] + 0.5) return score[0] < score[1];
+  if (a->refreshRate != b->refreshRate) return a->refreshRate > b->refreshRate;
+  return scale[0] > scale[1];
+}
+
+const GLFWvidmode *display_best_mode(GLFWmonitor *monitor, int width, int height) {
+  const GLFWvidmode *modes, *best = NULL, *desktop = glfwGetVideoMode(monitor);
+  int count;
+
+  modes = glfwGetVideoModes(monitor, &count);
+  if (!modes || !desktop) return desktop;
+  for (int i = 0; i < count; i++) {
+    if (modes[i].width < width || modes[i].height < height) continue;
+    if (!best || better_mode(&modes[i], best, width, height, desktop->refreshRate)) best = &modes[i];
+  }
+  return best ? best : desktop;
+}
+
+int display_fit_frame(GLFWmonitor *monitor, int *width, int *height) {
+  const GLFWvidmode *mode = glfwGetVideoMode(monitor);
+  int scale;
+
+  if (!mode || *width <= 0 || *height <= 0) return 0;
+  scale = mode->width / *width < mode->height / *height ? mode->width / *width : mode->height / *height;
+  if (scale < 1) return 0;
+  // Без остатка по обеим сторонам: 1366 / 3 оставило бы полосу в пиксель
+  while (mode->width % scale || mode->height % scale) scale--;
+  *width = mode->width / scale;
+  *height = mode->height / scale;
+  return scale;
+}
+
+/* monitor == NULL - основной монитор; share - окно с общими объектами GL
+   или NULL; width x height - кадр, под который выбирается режим */
+static GLFWwindow *create_window(int flags, GLFWmonitor *monitor, GLFWwindow *share, int width, int height) {
+  GLFWwindow *win;
+  int x, y;
+
+  if (!monitor) monitor = glfwGetPrimaryMonitor();
+  if (!monitor) {
+    printf("No monitor\n");
+    return NULL;
+  }
+  // Получение режима видео для монитора
+  const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+
+  // Создание окна; подсказки остаются от прошлых окон, поэтому - заново
+  glfwDefaultWindowHints();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  if (flags & DISPLAY_HIDDEN) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  if (flags & (DISPLAY_WINDOWED | DISPLAY_HIDDEN)) {
+    win = glfwCreateWindow(mode->width / 2, mode->height / 2, "Program", NULL, share);
+  } else if (flags & DISPLAY_BORDERLESS) {
+    // Окно без рамки на весь монитор: режим экрана не меняется
+    glfwWindowHint(GLFW_DECORATED, GLFW_FALSE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    win = glfwCreateWindow(mode->width, mode->height, "Program", NULL, share);
+    if (win) {
+      glfwGetMonitorPos(monitor, &x, &y);
+      glfwSetWindowPos(win, x, y);
+      glfwShowWindow(win);
+    }
+  } else {
+    glfwWindowHint(GLFW_DECORATED, GLFW_FALSE); // Окно без рамки
+    glfwWindowHint(GLFW_AUTO_ICONIFY, GLFW_FALSE); // Без автосворачивания
+    if (flags & DISPLAY_INTEGER_SCALE) {
+      // Переключение в режим, в который кадр входит целое число раз
+      mode = display_best_mode(monitor, width, height);
+      glfwWindowHint(GLFW_REFRESH_RATE, mode->refreshRate);
+    }
+    win = glfwCreateWindow(mode->width, mode->height, "Program", monitor, share);
+  }
+  if (!win) {
+    printf("Failed to create GLFW window\n");
+    return NULL;
+  }
+  //glfwSetInputMode(win, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+  glfwMakeContextCurrent(win);
+  glfwSwapInterval(0);
+
+  if (glewInit() != GLEW_OK) {
+    printf("Failed to initialize GLEW\n");
+    glfwDestroyWindow(win);
+    return NULL;
+  }
+  pix_init_format();
+
+  return win;
+}
+
+static Display *open_display(int width, int height, int flags, GLFWmonitor *monitor, GLFWwindow *share) {
+  Display *d;
+  int w, h;
+
+  if (width <= 0 || height <= 0) return NULL;
+  if (openCount == 0 && !glfwInit()) return NULL;
+  d = calloc(1, sizeof(Display));
+  if (!d) return NULL;
+  d->width = width;
+  d->height = height;
+  d->flags = flags;
+  d->win = create_window(flags, monitor, share, width, height);
+  d->fd = -1;
+  d->pixels = alloc_frame(d);
+  if (!d->win || !d->pixels) {
+    if (d->win) glfwDestroyWindow(d->win);
+    if (d->pixels) free_frame(d);
+    free(d);
+    if (openCount == 0) glfwTerminate();
+    return NULL;
+  }
+  openCount++;
+  memset(d->pixels, 0, (size_t)d->stride * height);
+
+  glfwSetWindowUserPointer(d->win, d);
+  glfwSetFramebufferSizeCallback(d->win, framebuffer_size_callback);
+  glfwSetKeyCallback(d->win, key_callback);
+  glfwSetCharCallback(d->win, char_callback);
+  glfwSetCursorPosCallback(d->win, cursor_callback);
+  glfwSetMouseButtonCallback(d->win, button_callback);
+  glfwSetScrollCallback(d->win, scroll_callback);
+  glfwSetWindowCloseCallback(d->win, close_callback);
+
+  init_buffers(d);
+  d->program = display_program(vertexSource, fragmentSource);
+  d->texture = pix_create_texture(width, height, d->pixels, d->stride);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  glfwGetFramebufferSize(d->win, &w, &h);
+  framebuffer_size_callback(d->win, w, h);
+  d->head = d->tail = 0; // Размер окна вызывающий узнаёт и так
+  return d;
+}
+
+Display *OpenDisplay(int32_t width, int32_t height, int32_t flags) {
+  Display *d = open_display(width, height, flags, NULL, NULL);
+
+  if (d && getenv("OBDISPLAY_RECORD")) record_start(d, getenv("OBDISPLAY_RECORD"));
+  return d;
+}
+
+Display *display_open_monitor(GLFWmonitor *monitor, int flags, GLFWwindow *share) {
+  const GLFWvidmode *mode = glfwGetVideoMode(monitor);
+
+  if (!mode) return NULL;
+  return open_display(mode->width, mode->height, flags, monitor, share);
+}
+
+int32_t GetFramebuffer(Display *d, unsigned char **pixels, int32_t *stride) {
+  if (!d) return 0;
+  *pixels = d->pixels;
+  *stride = d->stride;
+  return 1;
+}
+
+void Flush(Display *d, const DisplayRect *rects, int32_t count) {
+  DisplayRect all = { 0, 0, d->width, d->height };
+
+  glfwMakeContextCurrent(d->win);
+  if (d->recorder) record_frame(d->recorder, d->pixels, d->stride, rects, count);
+  if (count <= 0) {
+    rects = &all;
+    count = 1;
+  }
+  // Загрузка только изменённых прямоугольников, прямо из кадра вызывающего
+  for (int i = 0; i < count; i++) {
+    int x0 = rects[i].x > 0 ? rects[i].x : 0, y0 = rects[i].y > 0 ? rects[i].y : 0;
+    int x1 = rects[i].x + rects[i].w, y1 = rects[i].y + rects[i].h;
+    if (x1 > d->width) x1 = d->width;
+    if (y1 > d->height) y1 = d->height;
+    if (x1 > x0 && y1 > y0) pix_upload(d->texture, x0, y0, x1 - x0, y1 - y0, d->pixels, d->stride);
+  }
+
+  glClearColor(0, 0, 0, 1.0);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glUseProgram(d->program);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, d->texture);
+  display_draw_quad(d);
+  glfwSwapBuffers(d->win);
+}
+
+/* Перенос прямоугольника текстуры кадра. Копия внутри одной текстуры с
+   перекрытием не определена, поэтому - через временную текстуру */
+static void copy_texture(Display *d, int x, int y, int w, int h, int sx, int sy) {
+  if (!d->scrollTexture) d->scrollTexture = pix_create_texture(d->width, d->height, NULL, 0);
+  if (GLEW_ARB_copy_image) {
+    glCopyImageSubData(d->texture, GL_TEXTURE_2D, 0, sx, sy, 0,
+        d->scrollTexture, GL_TEXTURE_2D, 0, 0, 0, 0, w, h, 1);
+    glCopyImageSubData(d->scrollTexture, GL_TEXTURE_2D, 0, 0, 0, 0,
+        d->texture, GL_TEXTURE_2D, 0, x, y, 0, w, h, 1);
+    return;
+  }
+  // GL 3.3: чтение из текстуры, прикреплённой к кадровому буферу
+  if (!d->scrollFbo) glGenFramebuffers(1, &d->scrollFbo);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, d->scrollFbo);
+  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, d->texture, 0);
+  glBindTexture(GL_TEXTURE_2D, d->scrollTexture);
+  glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, sx, sy, w, h);
+  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, d->scrollTexture, 0);
+  glBindTexture(GL_TEXTURE_2D, d->texture);
+  glCopyTexSubImage2D(GL_TEXTURE_2D, 0, x, y, 0, 0, w, h);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void ScrollRect(Display *d, const DisplayRect *rect, int32_t dx, int32_t dy) {
+  int x0 = rect->x > 0 ? rect->x : 0, y0 = rect->y > 0 ? rect->y : 0;
+  int x1 = rect->x + rect->w, y1 = rect->y + rect->h;
+  int x, y, w, h;
+
+  if (x1 > d->width) x1 = d->width;
+  if (y1 > d->height) y1 = d->height;
+  // Часть прямоугольника, которая остаётся в нём после сдвига
+  x = x0 + (dx > 0 ? dx : 0);
+  y = y0 + (dy > 0 ? dy : 0);
+  w = x1 - x0 - (dx > 0 ? dx : -dx);
+  h = y1 - y0 - (dy > 0 ? dy : -dy);
+  if (w <= 0 || h <= 0 || (dx == 0 && dy == 0)) return;
+
+  glfwMakeContextCurrent(d->win);
+  pix_move(d->pixels, d->stride, x, y, w, h, x - dx, y - dy);
+  copy_texture(d, x, y, w, h, x - dx, y - dy);
+  if (d->recorder) record_scroll(d->recorder, (DisplayRect){ x, y, w, h }, x - dx, y - dy);
+}
+
+int32_t NextEvent(Display *d, DisplayEvent *event, int32_t timeoutMs) {
+  if (d->head == d->tail) {
+    if (timeoutMs < 0) glfwWaitEvents();
+    else if (timeoutMs > 0) glfwWaitEventsTimeout(timeoutMs / 1000.0);
+    else glfwPollEvents();
+  }
+  if (d->head == d->tail) {
+    event->type = EVENT_NONE;
+    return 0;
+  }
+  *event = d->queue[d->head];
+  d->head = (d->head + 1) % DISPLAY_QUEUE;
+  return 1;
+}
+
+void Close(Display *d) {
+  if (!d) return;
+  record_stop(d);
+  glfwMakeContextCurrent(d->win);
+  glDeleteTextures(1, &d->texture);
+  if (d->scrollTexture) glDeleteTextures(1, &d->scrollTexture);
+  if (d->scrollFbo) glDeleteFramebuffers(1, &d->scrollFbo);
+  glDeleteProgram(d->program);
+  glDeleteVertexArrays(1, &d->vao);
+  glDeleteBuffers(1, &d->vbo);
+  glDeleteBuffers(1, &d->ebo);
+  glfwDestroyWindow(d->win);
+  free_frame(d);
+  free(d);
+  if (--openCount == 0) glfwTerminate();
+}
@@ -0,0 +1,105 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdint.h>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+/* Окно с логическим кадровым буфером (libobdisplay.so). Кадр лежит в
+   обычной памяти в формате pixfmt (BGRA, строки выровнены), вызывающий
+   пишет пиксели прямо в него, а Flush загружает в текстуру только
+   перечисленные прямоугольники - без промежуточных копий - и выводит
+   кадр на экран с сохранением пропорций.
+
+   Функции с заглавной буквы - стабильный C ABI для Oberon: только
+   указатели и 32-битные целые, Display для вызывающего непрозрачен.
+   Остальное - для программ на C из этого репозитория (main.c). */
+
+#define DISPLAY_API __attribute__((visibility("default")))
+
+/* Флаги OpenDisplay; DISPLAY_HIDDEN - окно не показывается
+   (воспроизведение записей), DISPLAY_BORDERLESS - окно без рамки на
+   весь монитор вместо полноэкранного режима. DISPLAY_INTEGER_SCALE -
+   кадр выводится с целым масштабом, пиксель в квадрат пикселей без
+   пересчёта, а полноэкранный режим переключает монитор в режим, лучший
+   для такого масштаба (display_best_mode). */
+enum {
+  DISPLAY_FULLSCREEN = 0, DISPLAY_WINDOWED = 1, DISPLAY_HIDDEN = 2, DISPLAY_BORDERLESS = 4,
+  DISPLAY_INTEGER_SCALE = 8
+};
+
+enum {
+  EVENT_NONE, EVENT_KEY, EVENT_CHAR, EVENT_MOUSE_MOVE, EVENT_MOUSE_BUTTON,
+  EVENT_SCROLL, EVENT_RESIZE, EVENT_CLOSE
+};
+
+// Все поля 32-битные, без дыр: раскладка одинакова для C и Oberon
+typedef struct DisplayEvent {
+  int32_t type;
+  int32_t x, y; // Мышь - в пикселях логического кадра; прокрутка - шаги; RESIZE - размер окна
+  int32_t key; // Код клавиши GLFW, кнопка мыши или символ Unicode (EVENT_CHAR)
+  int32_t action; // GLFW_PRESS, GLFW_RELEASE, GLFW_REPEAT
+  int32_t mods;
+} DisplayEvent;
+
+typedef struct DisplayRect {
+  int32_t x, y, w, h;
+} DisplayRect;
+
+#define DISPLAY_QUEUE 256
+
+typedef struct Display {
+  GLFWwindow *win;
+  int width, height; // Логический кадр
+  int flags; // Флаги OpenDisplay
+  unsigned char *pixels;
+  int stride;
+  int fd; // memfd кадра или -1, если кадр в обычной памяти
+  GLuint texture, program, vao, vbo, ebo;
+  GLuint scrollTexture, scrollFbo; // Для ScrollRect, создаются при первой прокрутке
+  int winW, winH; // Размер окна в пикселях
+  int viewX, viewY, viewW, viewH; // Область вывода кадра в окне (glViewport)
+  DisplayEvent queue[DISPLAY_QUEUE];
+  int head, tail;
+  struct Recorder *recorder; // Запись сеанса (record.h) или NULL
+} Display;
+
+// C ABI
+
+DISPLAY_API Display *OpenDisplay(int32_t width, int32_t height, int32_t flags);
+// Адрес кадра и шаг строки в байтах; кадр живёт до Close
+DISPLAY_API int32_t GetFramebuffer(Display *d, unsigned char **pixels, int32_t *stride);
+// Загружает прямоугольники кадра (count == 0 - весь кадр) и выводит его на экран
+DISPLAY_API void Flush(Display *d, const DisplayRect *rects, int32_t count);
+/* Сдвигает содержимое rect на (dx, dy) в кадре и в текстуре сразу, без
+   загрузки; вышедшее за rect отбрасывается. Открывшуюся полосу
+   вызывающий рисует сам и передаёт в следующий Flush. Изменения в rect,
+   ещё не переданные в Flush, надо передать до прокрутки. */
+DISPLAY_API void ScrollRect(Display *d, const DisplayRect *rect, int32_t dx, int32_t dy);
+/* Следующее событие: 1, если есть. timeoutMs: 0 - не ждать,
+   меньше нуля - ждать без ограничения */
+DISPLAY_API int32_t NextEvent(Display *d, DisplayEvent *event, int32_t timeoutMs);
+DISPLAY_API void Close(Display *d);
+
+// Для программ на C
+
+// Сборка программы из исходников шейдеров; ошибки печатаются в stderr
+GLuint display_program(const char *vertexSource, const char *fragmentSource);
+/* Режим монитора для кадра width x height (glfwGetVideoModes): меньше
+   всего полей вокруг кадра при целом масштабе, частота не ниже, чем у
+   рабочего стола, при равенстве - чаще частота и крупнее масштаб */
+const GLFWvidmode *display_best_mode(GLFWmonitor *monitor, int width, int height);
+/* Логический кадр не меньше width x height, который входит в текущий
+   режим монитора целое число раз по обеим сторонам без остатка
+   (наибольший такой масштаб, в худшем случае 1); возвращает масштаб
+   или 0, если режим меньше кадра */
+int display_fit_frame(GLFWmonitor *monitor, int *width, int *height);
+/* Окно на мониторе monitor (glfwGetMonitors) с кадром по размеру его
+   режима; объекты GL общие с окном share (может быть NULL) */
+Display *display_open_monitor(GLFWmonitor *monitor, int flags, GLFWwindow *share);
+// Прямоугольник на всю область вывода, TexCoord (0, 0) - левый верхний угол
+void display_draw_quad(Display *d);
+// Координаты курсора в окне -> пиксели логического кадра
+void display_to_frame(Display *d, double x, double y, int *fx, int *fy);
+
+#endif
@@ -0,0 +1,91 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "pixfmt.h"
+#include "effects.h"
+
+static int lutW, lutH;
+static GLuint texture;
+static unsigned char *pixels;
+static int stride;
+
+// Не зависит от времени: свечение и функции от y
+static float *glow; // 1 - length(pos) / 2
+static float *cosY, *sinY; // cos(pos.y), sin(pos.y)
+static float *cosTX, *sinTX; // cos(time + pos.x), sin(time + pos.x) для текущего кадра
+
+// Координата pos узла i из n: узлы лежат на концах отрезка [-1, 1]
+static float node(int i, int n) {
+  return n > 1 ? -1.0f + 2.0f * i / (n - 1) : 0.0f;
+}
+
+void effect_init(int width, int height) {
+  lutW = width;
+  lutH = height;
+  pixels = pix_alloc(width, height, &stride);
+  glow = malloc(sizeof(float) * width * height);
+  cosY = malloc(sizeof(float) * height);
+  sinY = malloc(sizeof(float) * height);
+  cosTX = malloc(sizeof(float) * width);
+  sinTX = malloc(sizeof(float) * width);
+  for (int y = 0; y < height; y++) {
+    float py = node(y, height);
+    cosY[y] = cosf(py);
+    sinY[y] = sinf(py);
+    for (int x = 0; x < width; x++) {
+      float px = node(x, width);
+      glow[y * width + x] = 1.0f - sqrtf(px * px + py * py) * 0.5f;
+    }
+  }
+  texture = pix_create_texture(width, height, NULL, stride);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void effect_shutdown(void) {
+  glDeleteTextures(1, &texture);
+  pix_free(pixels);
+  free(glow);
+  free(cosY);
+  free(sinY);
+  free(cosTX);
+  free(sinTX);
+  texture = 0;
+  pixels = NULL;
+}
+
+static unsigned char to_byte(float v) {
+  return v <= 0.0f ? 0 : v >= 1.0f ? 255 : (unsigned char)(v * 255.0f + 0.5f);
+}
+
+void effect_update(double time) {
+  float t = (float)time;
+  float pulse = sinf(t * 1.5f);
+
+  for (int x = 0; x < lutW; x++) {
+    cosTX[x] = cosf(t + node(x, lutW));
+    sinTX[x] = sinf(t + node(x, lutW));
+  }
+  for (int y = 0; y < lutH; y++) {
+    float g = sinf(t + node(y, lutH)) * 0.5f + 0.5f;
+    const float *gl = glow + y * lutW;
+    unsigned char *d = pixels + (size_t)y * stride;
+    for (int x = 0; x < lutW; x++) {
+      float r = cosTX[x] * 0.5f + 0.5f;
+      // cos(time + pos.x + pos.y) через суммы углов
+      float b = pulse * (cosTX[x] * cosY[y] - sinTX[x] * sinY[y]) * 0.5f + 0.5f;
+      d[0] = to_byte(b * gl[x]);
+      d[1] = to_byte(g * gl[x]);
+      d[2] = to_byte(r * gl[x]);
+      d[3] = 255;
+      d += PIX_BPP;
+    }
+  }
+  pix_upload(texture, 0, 0, lutW, lutH, pixels, stride);
+}
+
+GLuint effect_texture(void) {
+  return texture;
+}
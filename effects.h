@@ -0,0 +1,21 @@
+#ifndef EFFECTS_H
+#define EFFECTS_H
+
+#include <GL/glew.h>
+
+/* Таблица эффекта свечения и переливов (shaders/effect.txt). Вместо
+   cos/sin/length в каждом фрагменте множитель цвета раз в кадр
+   считается на процессоре в маленькой текстуре width x height и
+   читается шейдером одной выборкой с линейной интерполяцией.
+   Тригонометрия раскладывается по строкам и столбцам, так что на кадр
+   нужно O(width + height) вызовов sin/cos, а не по одному на тексель. */
+
+// Нужен текущий GL-контекст
+void effect_init(int width, int height);
+void effect_shutdown(void);
+
+// Пересчитывает таблицу на момент time и загружает её в текстуру
+void effect_update(double time);
+GLuint effect_texture(void);
+
+#endif
@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "font.h"
+#include "sprites.h"
+
+#define FNT_ID 0xDB // Первый байт файла шрифта Oberon
+#define MAX_GLYPHS 65535 // Номер + 1 должен уместиться в uint16_t
+
+// --- Построение ---
+
+typedef struct Builder {
+  Font *font;
+  int glyphCap;
+  size_t maskCap;
+} Builder;
+
+/* Новый символ с нулевой маской w x h; маска - f->masks + g->mask
+   (адрес действителен до следующего add_glyph). NULL при ошибке. */
+static Glyph *add_glyph(Builder *b, unsigned code, int dx, int left, int top, int w, int h) {
+  Font *f = b->font;
+  size_t size = (size_t)w * h;
+  Glyph *g;
+  void *p;
+
+  if (code > 0xFFFF || w < 0 || h < 0 || f->glyphCount == MAX_GLYPHS) return NULL;
+  if (f->pages[code >> 8] && f->pages[code >> 8][code & 255]) return NULL; // Повтор кода
+  if (f->glyphCount == b->glyphCap) {
+    b->glyphCap = b->glyphCap ? b->glyphCap * 2 : 256;
+    p = realloc(f->glyphs, b->glyphCap * sizeof(Glyph));
+    if (!p) return NULL;
+    f->glyphs = p;
+  }
+  if (f->masksSize + size > b->maskCap) {
+    while (f->masksSize + size > b->maskCap) b->maskCap = b->maskCap ? b->maskCap * 2 : 16384;
+    p = realloc(f->masks, b->maskCap);
+    if (!p) return NULL;
+    f->masks = p;
+  }
+  if (!f->pages[code >> 8]) {
+    f->pages[code >> 8] = calloc(256, sizeof(uint16_t));
+    if (!f->pages[code >> 8]) return NULL;
+  }
+
+  g = &f->glyphs[f->glyphCount++];
+  g->dx = dx;
+  g->left = left;
+  g->top = top;
+  g->w = w;
+  g->h = h;
+  g->mask = f->masksSize;
+  g->image = NULL;
+  memset(f->masks + f->masksSize, 0, size);
+  f->masksSize += size;
+  f->pages[code >> 8][code & 255] = f->glyphCount;
+  return g;
+}
+
+// --- Oberon .Fnt ---
+
+static int read16(FILE *file) {
+  int lo = getc(file), hi = getc(file);
+  return (int16_t)(lo | hi << 8);
+}
+
+/* Заголовок: id, тип, семейство, вариант, затем int16: высота, minX,
+   maxX, minY, maxY, число диапазонов кодов [beg, end). Далее по
+   символу: dx, x, y, w, h (x, y - левый нижний угол от базовой линии),
+   и растры: строки по (w + 7) / 8 байт снизу вверх, младший бит слева. */
+static int load_fnt(Builder *b, FILE *file) {
+  Font *f = b->font;
+  int runs, (*run)[2], boxCount = 0, (*box)[5], ok = 1;
+  unsigned char row[256];
+  Glyph *g;
+
+  getc(file); // id
+  getc(file); // тип
+  getc(file); // семейство
+  getc(file); // вариант
+  f->height = read16(file);
+  read16(file); // minX
+  read16(file); // maxX
+  f->descent = -read16(file);
+  f->ascent = read16(file);
+  runs = read16(file);
+  if (feof(file) || runs <= 0) return 0;
+
+  run = malloc(runs * sizeof(*run));
+  if (!run) return 0;
+  for (int i = 0; i < runs; i++) {
+    run[i][0] = read16(file);
+    run[i][1] = read16(file);
+    if (run[i][0] < 0 || run[i][1] < run[i][0]) ok = 0;
+    else boxCount += run[i][1] - run[i][0];
+  }
+  box = ok && !feof(file) ? malloc((boxCount + 1) * sizeof(*box)) : NULL;
+  if (!box) {
+    free(run);
+    return 0;
+  }
+  for (int i = 0; i < boxCount; i++) {
+    for (int k = 0; k < 5; k++) box[i][k] = read16(file);
+  }
+
+  for (int i = 0, n = 0; ok && i < runs; i++) {
+    for (int code = run[i][0]; ok && code < run[i][1]; code++, n++) {
+      int w = box[n][3], h = box[n][4], bytes = (w + 7) / 8;
+      g = add_glyph(b, code, box[n][0], box[n][1], box[n][2] + h, w, h);
+      if (!g || bytes > (int)sizeof(row)) {
+        ok = 0;
+        break;
+      }
+      for (int y = h - 1; y >= 0; y--) {
+        unsigned char *m = f->masks + g->mask + (size_t)y * w;
+        if (fread(row, 1, bytes, file) != (size_t)bytes) ok = 0;
+        for (int x = 0; x < w; x++) m[x] = row[x >> 3] >> (x & 7) & 1 ? 0xFF : 0;
+      }
+    }
+  }
+  free(run);
+  free(box);
+  return ok;
+}
+
+// --- BDF ---
+
+static int hex_digit(int c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static int load_bdf(Builder *b, FILE *file) {
+  Font *f = b->font;
+  char line[1024];
+  int code = -1, dx = 0, w = 0, h = 0, xoff = 0, yoff = 0, bbox[4] = { 0 };
+  int ascent = -1, descent = -1, chars = 0;
+  Glyph *g;
+
+  while (fgets(line, sizeof(line), file)) {
+    if (sscanf(line, "FONTBOUNDINGBOX %d %d %d %d", &bbox[0], &bbox[1], &bbox[2], &bbox[3]) == 4) continue;
+    if (sscanf(line, "FONT_ASCENT %d", &ascent) == 1) continue;
+    if (sscanf(line, "FONT_DESCENT %d", &descent) == 1) continue;
+    if (sscanf(line, "ENCODING %d", &code) == 1) continue;
+    if (sscanf(line, "DWIDTH %d", &dx) == 1) continue;
+    if (sscanf(line, "BBX %d %d %d %d", &w, &h, &xoff, &yoff) == 4) continue;
+    if (strncmp(line, "STARTCHAR", 9) == 0) {
+      code = -1;
+      dx = w = h = xoff = yoff = 0;
+      continue;
+    }
+    if (strncmp(line, "BITMAP", 6) != 0) continue;
+
+    // Строки маски сверху вниз, шестнадцатеричные, старший бит слева
+    g = code >= 0 ? add_glyph(b, code, dx, xoff, yoff + h, w, h) : NULL;
+    for (int y = 0; y < h && fgets(line, sizeof(line), file); y++) {
+      if (!g) continue;
+      unsigned char *m = f->masks + g->mask + (size_t)y * w;
+      int digits = strlen(line);
+      for (int x = 0; x < w && x / 4 < digits; x++) {
+        int d = hex_digit(line[x / 4]);
+        if (d >= 0 && d >> (3 - x % 4) & 1) m[x] = 0xFF;
+      }
+    }
+    if (g) chars++;
+  }
+
+  f->ascent = ascent >= 0 ? ascent : bbox[1] + bbox[3];
+  f->descent = descent >= 0 ? descent : -bbox[3];
+  f->height = f->ascent + f->descent;
+  return chars > 0;
+}
+
+Font *font_load(const char *filename) {
+  Builder b = { 0 };
+  FILE *file = fopen(filename, "rb");
+  char start[9] = { 0 };
+  int ok;
+
+  if (!file) return NULL;
+  b.font = calloc(1, sizeof(Font));
+  if (!b.font) {
+    fclose(file);
+    return NULL;
+  }
+  if (fread(start, 1, 9, file) < 1) start[0] = 0;
+  rewind(file);
+  if ((unsigned char)start[0] == FNT_ID) ok = load_fnt(&b, file);
+  else if (memcmp(start, "STARTFONT", 9) == 0) ok = load_bdf(&b, file);
+  else ok = 0;
+  fclose(file);
+  if (!ok) {
+    fprintf(stderr, "Не удалось загрузить шрифт %s\n", filename);
+    font_free(b.font);
+    return NULL;
+  }
+  return b.font;
+}
+
+void font_free(Font *font) {
+  if (!font) return;
+  if (font->atlas) {
+    for (int i = 0; i < font->glyphCount; i++) {
+      if (font->glyphs[i].image) atlas_evict(font->atlas, font->glyphs[i].image);
+    }
+  }
+  for (int i = 0; i < 256; i++) free(font->pages[i]);
+  free(font->glyphs);
+  free(font->masks);
+  free(font);
+}
+
+// --- Вывод в кадр ---
+
+const Glyph *font_glyph(Font *font, unsigned code) {
+  uint16_t *page;
+
+  if (code <= 0xFFFF && (page = font->pages[code >> 8]) && page[code & 255]) {
+    return &font->glyphs[page[code & 255] - 1];
+  }
+  page = font->pages[0];
+  return page && page['?'] ? &font->glyphs[page['?'] - 1] : NULL;
+}
+
+// Следующий символ UTF-8; байт вне UTF-8 - символ Latin-1. 0 в конце строки
+static unsigned next_char(const char **text) {
+  const unsigned char *s = (const unsigned char *)*text;
+  unsigned c = s[0], code;
+  int n, i;
+
+  if (c < 0x80) {
+    if (c) (*text)++;
+    return c;
+  }
+  n = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+  code = c & (0x3F >> n);
+  for (i = 1; i <= n && (s[i] & 0xC0) == 0x80; i++) code = code << 6 | (s[i] & 0x3F);
+  if (n == 0 || i <= n) {
+    (*text)++;
+    return c;
+  }
+  *text += n + 1;
+  return code;
+}
+
+int font_width(Font *font, const char *text) {
+  const Glyph *g;
+  unsigned code;
+  int w = 0;
+
+  while ((code = next_char(&text))) {
+    if ((g = font_glyph(font, code))) w += g->dx;
+  }
+  return w;
+}
+
+// Строка маски mask (n пикселей) в dst
+static void blend_row(uint32_t *dst, const unsigned char *mask, int n, uint32_t color, int mode) {
+  uint32_t bits = mode == FONT_INVERT ? 0x00FFFFFF : color;
+  int i = 0;
+
+#ifdef __SSE2__
+  __m128i c = _mm_set1_epi32(bits);
+  for (; i + 4 <= n; i += 4) {
+    uint32_t m4;
+    memcpy(&m4, mask + i, 4);
+    if (m4 == 0) continue; // Пустые места внутри символа - частый случай
+    // 4 байта маски -> 4 маски по 32 бита
+    __m128i m = _mm_cvtsi32_si128(m4);
+    m = _mm_unpacklo_epi8(m, m);
+    m = _mm_unpacklo_epi16(m, m);
+    __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+    if (mode == FONT_INVERT) d = _mm_xor_si128(d, _mm_and_si128(m, c));
+    else d = _mm_or_si128(_mm_and_si128(m, c), _mm_andnot_si128(m, d));
+    _mm_storeu_si128((__m128i *)(dst + i), d);
+  }
+#endif
+  for (; i < n; i++) {
+    if (!mask[i]) continue;
+    dst[i] = mode == FONT_INVERT ? dst[i] ^ bits : bits;
+  }
+}
+
+static void fill(const FontTarget *t, int x0, int y0, int x1, int y1, uint32_t color) {
+  if (x0 < t->x0) x0 = t->x0;
+  if (y0 < t->y0) y0 = t->y0;
+  if (x1 > t->x1) x1 = t->x1;
+  if (y1 > t->y1) y1 = t->y1;
+  for (int y = y0; y < y1; y++) {
+    uint32_t *row = (uint32_t *)(t->pixels + (size_t)y * t->stride);
+    for (int x = x0; x < x1; x++) row[x] = color;
+  }
+}
+
+int font_draw(Font *font, const FontTarget *target, int x, int y, const char *text,
+    uint32_t color, uint32_t background, int mode) {
+  const Glyph *g;
+  unsigned code;
+
+  while ((code = next_char(&text))) {
+    if (!(g = font_glyph(font, code))) continue;
+    if (mode == FONT_REPLACE) fill(target, x, y - font->ascent, x + g->dx, y + font->descent, background);
+
+    // Маска, обрезанная прямоугольником отсечения
+    int gx = x + g->left, gy = y - g->top;
+    int x0 = gx > target->x0 ? gx : target->x0, x1 = gx + g->w < target->x1 ? gx + g->w : target->x1;
+    int y0 = gy > target->y0 ? gy : target->y0, y1 = gy + g->h < target->y1 ? gy + g->h : target->y1;
+    for (int row = y0; row < y1; row++) {
+      blend_row((uint32_t *)(target->pixels + (size_t)row * target->stride) + x0,
+          font->masks + g->mask + (size_t)(row - gy) * g->w + (x0 - gx), x1 - x0, color, mode);
+    }
+    x += g->dx;
+  }
+  return x;
+}
+
+// --- Вывод через GPU ---
+
+int font_upload(Font *font, Atlas *atlas) {
+  uint32_t *pixels = NULL;
+  size_t cap = 0;
+  int ok = 1;
+
+  for (int i = 0; i < font->glyphCount && ok; i++) {
+    Glyph *g = &font->glyphs[i];
+    size_t size = (size_t)g->w * g->h;
+    if (size == 0 || g->image) continue;
+    if (size > cap) {
+      free(pixels);
+      cap = size;
+      pixels = malloc(cap * 4);
+      if (!pixels) return 0;
+    }
+    // Белый символ с маской в альфе: цвет задаётся при выводе
+    for (size_t k = 0; k < size; k++) pixels[k] = font->masks[g->mask + k] ? 0xFFFFFFFF : 0x00FFFFFF;
+    g->image = atlas_insert(atlas, (unsigned char *)pixels, g->w * 4, g->w, g->h);
+    if (!g->image) ok = 0;
+  }
+  free(pixels);
+  font->atlas = atlas;
+  atlas_flush(atlas);
+  return ok;
+}
+
+float font_draw_gpu(Font *font, float x, float y, const char *text, uint32_t color) {
+  const Glyph *g;
+  unsigned code;
+
+  while ((code = next_char(&text))) {
+    if (!(g = font_glyph(font, code))) continue;
+    if (g->image) {
+      AtlasImage *im = g->image;
+      sprite_draw(atlas_texture(font->atlas, im->page), x + g->left, y - g->top, g->w, g->h,
+          im->u0, im->v0, im->u1, im->v1, color);
+    }
+    x += g->dx;
+  }
+  return x;
+}
@@ -0,0 +1,70 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <stdint.h>
+
+#include "atlas.h"
+
+/* Растровые шрифты: Oberon .Fnt и BDF. При загрузке биты каждого
+   символа разворачиваются в маску по байту на пиксель (0 или 0xFF), и
+   все маски шрифта лежат подряд в одном массиве - вывод строки читает
+   память последовательно и смешивает по 4 пикселя за раз (SSE2).
+
+   Координаты - в пикселях кадра, (0, 0) - левый верхний угол; y строки
+   - базовая линия. Текст - UTF-8; байты, которые не складываются в
+   UTF-8, берутся как Latin-1 (тексты Oberon). Символы, которых нет в
+   шрифте, выводятся как '?'.
+
+   Кадр - BGRA (pixfmt), цвета - 0xAARRGGBB. */
+
+enum {
+  FONT_REPLACE, // Ячейка символа заливается фоном, символ - цветом
+  FONT_PAINT, // Только пиксели символа, остальное не трогается
+  FONT_INVERT // Пиксели символа инвертируются (RGB), цвет не важен
+};
+
+typedef struct Glyph {
+  int16_t dx; // Сдвиг к следующему символу
+  int16_t left, top; // Левый верхний угол маски от точки на базовой линии (top - вверх)
+  int16_t w, h;
+  uint32_t mask; // Смещение маски в Font.masks, строки сверху вниз по w байт
+  AtlasImage *image; // Для вывода через GPU (font_upload)
+} Glyph;
+
+typedef struct Font {
+  int height; // Шаг строк
+  int ascent, descent; // Ячейка символа: ascent над базовой линией, descent под ней
+  Glyph *glyphs;
+  int glyphCount;
+  uint16_t *pages[256]; // Код -> номер символа + 1, страницами по 256 кодов
+  unsigned char *masks;
+  size_t masksSize;
+  Atlas *atlas;
+} Font;
+
+// Куда выводится текст: кадр и прямоугольник отсечения [x0, x1) x [y0, y1)
+typedef struct FontTarget {
+  unsigned char *pixels;
+  int stride;
+  int x0, y0, x1, y1;
+} FontTarget;
+
+// Формат - по первому байту файла (0xDB - .Fnt) или STARTFONT (BDF)
+Font *font_load(const char *filename);
+void font_free(Font *font);
+
+const Glyph *font_glyph(Font *font, unsigned code);
+int font_width(Font *font, const char *text);
+
+// Выводит text с базовой линией в (x, y); возвращает x после текста
+int font_draw(Font *font, const FontTarget *target, int x, int y, const char *text,
+    uint32_t color, uint32_t background, int mode);
+
+/* Вывод через GPU. font_upload кладёт маски символов в атлас (белые,
+   маска - в альфе) и загружает его, нужен GL-контекст. font_draw_gpu
+   добавляет символы спрайтами в текущий пакет sprite_begin/sprite_end:
+   вся строка рисуется одним вызовом на страницу атласа. */
+int font_upload(Font *font, Atlas *atlas);
+float font_draw_gpu(Font *font, float x, float y, const char *text, uint32_t color);
+
+#endif
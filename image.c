@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "pixfmt.h"
+#include "jobpool.h"
+#include "image.h"
+
+/* Арена потока для временных буферов stb_image: память резервируется
+   один раз, выделение - сдвиг указателя, освобождение - сброс после
+   декодирования. Что не поместилось, берётся обычным malloc. */
+
+#define ARENA_RESERVE ((size_t)512 << 20)
+#define ARENA_KEEP ((size_t)16 << 20) // Столько памяти арена не возвращает системе
+#define ARENA_ALIGN 16
+
+typedef struct Arena {
+  unsigned char *base;
+  size_t used, last, peak;
+} Arena;
+
+static __thread Arena arena;
+
+static void *arena_alloc(size_t size) {
+  size_t at;
+
+  if (!arena.base) {
+    void *p = mmap(NULL, ARENA_RESERVE, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    arena.base = p == MAP_FAILED ? NULL : p;
+  }
+  at = (arena.used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  if (!arena.base || size > ARENA_RESERVE - at) return malloc(size);
+  arena.last = at;
+  arena.used = at + size;
+  if (arena.used > arena.peak) arena.peak = arena.used;
+  return arena.base + at;
+}
+
+static int in_arena(const void *p) {
+  return arena.base && (const unsigned char *)p >= arena.base
+      && (const unsigned char *)p < arena.base + ARENA_RESERVE;
+}
+
+static void arena_free(void *p) {
+  if (!p) return;
+  if (!in_arena(p)) {
+    free(p);
+  } else if ((unsigned char *)p == arena.base + arena.last) {
+    arena.used = arena.last; // Последний блок можно вернуть сразу
+  }
+}
+
+static void *arena_realloc(void *p, size_t oldSize, size_t newSize) {
+  void *q;
+
+  if (!p) return arena_alloc(newSize);
+  if (!in_arena(p)) return realloc(p, newSize);
+  // Буфер zlib растёт в конце арены - расширяем на месте
+  if ((unsigned char *)p == arena.base + arena.last && newSize <= ARENA_RESERVE - arena.last) {
+    arena.used = arena.last + newSize;
+    if (arena.used > arena.peak) arena.peak = arena.used;
+    return p;
+  }
+  q = arena_alloc(newSize);
+  if (q) memcpy(q, p, oldSize < newSize ? oldSize : newSize);
+  arena_free(p);
+  return q;
+}
+
+static void arena_reset(void) {
+  if (arena.peak > ARENA_KEEP) {
+    madvise(arena.base + ARENA_KEEP, arena.peak - ARENA_KEEP, MADV_DONTNEED);
+  }
+  arena.used = arena.last = arena.peak = 0;
+}
+
+#define STBI_MALLOC(sz) arena_alloc(sz)
+#define STBI_REALLOC_SIZED(p, oldsz, newsz) arena_realloc(p, oldsz, newsz)
+#define STBI_FREE(p) arena_free(p)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+typedef struct Dest {
+  ImageDestFunc *func;
+  void *user;
+  unsigned char *pixels;
+  int stride;
+} Dest;
+
+// Вызывается декодером JPEG, как только известен размер изображения
+static stbi_uc *jpeg_dest(void *user, int x, int y, int comp, int *stride) {
+  Dest *d = user;
+  if (comp != PIX_BPP) return NULL;
+  d->pixels = d->func(d->user, x, y, &d->stride);
+  *stride = d->stride;
+  return d->pixels;
+}
+
+int img_info(const unsigned char *data, size_t size, int *width, int *height) {
+  int channels;
+  return stbi_info_from_memory(data, size, width, height, &channels);
+}
+
+int img_decode(const unsigned char *data, size_t size,
+    ImageDestFunc *dest, void *user, int *width, int *height) {
+  return img_decode_scaled(data, size, 0, 0, dest, user, width, height);
+}
+
+int img_decode_scaled(const unsigned char *data, size_t size, int maxWidth, int maxHeight,
+    ImageDestFunc *dest, void *user, int *width, int *height) {
+  Dest d = { dest, user, NULL, 0 };
+  int channels, isJpeg = size > 2 && data[0] == 0xFF && data[1] == 0xD8;
+  unsigned char *result;
+
+  // JPEG сразу выдаёт BGRA, остальным форматам нужен pix_convert
+  stbi_set_output_destination_thread(jpeg_dest, &d, 1);
+  stbi_set_jpeg_max_size_thread(maxWidth, maxHeight);
+  stbi_set_parallel_thread(pool_run); // Без pool_init выполняется в этом же потоке
+  result = stbi_load_from_memory(data, size, width, height, &channels, isJpeg ? PIX_BPP : 0);
+  stbi_set_parallel_thread(NULL);
+  stbi_set_jpeg_max_size_thread(0, 0);
+  stbi_set_output_destination_thread(NULL, NULL, 0);
+
+  if (result && result != d.pixels) {
+    d.pixels = dest(user, *width, *height, &d.stride);
+    if (d.pixels) {
+      pix_convert(result, *width * channels, channels, d.pixels, d.stride, *width, *height);
+    } else {
+      stbi__err("outofmem", "Out of memory");
+    }
+    arena_free(result);
+  }
+  arena_reset();
+  return result && d.pixels;
+}
+
+const char *img_failure_reason(void) {
+  return stbi_failure_reason();
+}
@@ -0,0 +1,26 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stddef.h>
+
+/* Обёртка над stb_image. Рабочие буферы декодера берутся из арены
+   потока (через STBI_MALLOC/STBI_FREE), а результат сразу пишется в
+   память вызывающего в формате pixfmt (BGRA): JPEG декодируется прямо
+   туда, остальные форматы - в арену и затем pix_convert. Назначением
+   может быть отображённый буфер распаковки (PBO) или кусок арены. */
+
+// Выдаёт память под width x height пикселей BGRA и шаг строки в байтах
+typedef unsigned char *ImageDestFunc(void *user, int width, int height, int *stride);
+
+int img_info(const unsigned char *data, size_t size, int *width, int *height);
+// Возвращает 1 при успехе, причину ошибки сообщает img_failure_reason
+int img_decode(const unsigned char *data, size_t size,
+    ImageDestFunc *dest, void *user, int *width, int *height);
+/* То же с ограничением размера: JPEG декодируется сразу уменьшенным в
+   2, 4 или 8 раз, чтобы поместиться в maxWidth x maxHeight. Остальные
+   форматы декодируются как есть. */
+int img_decode_scaled(const unsigned char *data, size_t size, int maxWidth, int maxHeight,
+    ImageDestFunc *dest, void *user, int *width, int *height);
+const char *img_failure_reason(void);
+
+#endif
@@ -0,0 +1,218 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "pixfmt.h"
+#include "imgcache.h"
+
+#define CACHE_MAGIC "OTEX"
+#define CACHE_VERSION 1
+#define CACHE_MAX_SIZE (1 << (CACHE_MAX_LEVELS - 1)) // Наибольшая ширина и высота
+
+typedef struct CacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t hash;
+  int64_t mtime;
+  uint32_t width, height, levels, variant;
+  uint64_t offset[CACHE_MAX_LEVELS];
+  uint32_t stride[CACHE_MAX_LEVELS];
+} CacheHeader;
+
+static char cacheDir[1024];
+int cacheMipmaps;
+
+void cache_init(const char *dir, int mipmaps) {
+  const char *home;
+
+  cacheMipmaps = mipmaps;
+  cacheDir[0] = '\0';
+  if (!dir) dir = getenv("IMGCACHE_DIR");
+  if (dir) {
+    snprintf(cacheDir, sizeof(cacheDir), "%s", dir);
+  } else if ((home = getenv("HOME"))) {
+    snprintf(cacheDir, sizeof(cacheDir), "%s/.cache", home);
+    mkdir(cacheDir, 0755);
+    snprintf(cacheDir, sizeof(cacheDir), "%s/.cache/glfw-experiments", home);
+  }
+  if (cacheDir[0] && mkdir(cacheDir, 0755) && errno != EEXIST) {
+    printf("Image cache disabled: can't create '%s'\n", cacheDir);
+    cacheDir[0] = '\0';
+  }
+}
+
+static void *map_file(const char *filename, size_t *size, long long *mtime) {
+  struct stat st;
+  void *p;
+  int fd = open(filename, O_RDONLY);
+
+  if (fd < 0) return NULL;
+  if (fstat(fd, &st) || st.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+  p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return NULL;
+  *size = st.st_size;
+  if (mtime) *mtime = st.st_mtime;
+  return p;
+}
+
+int cache_source_open(const char *filename, CacheSource *src) {
+  uint64_t h = 0xcbf29ce484222325ull; // FNV-1a
+
+  src->data = map_file(filename, &src->size, &src->mtime);
+  if (!src->data) return 0;
+  for (size_t i = 0; i < src->size; i++) {
+    h = (h ^ src->data[i]) * 0x100000001b3ull;
+  }
+  src->hash = h;
+  src->variant = 0;
+  return 1;
+}
+
+void cache_source_close(CacheSource *src) {
+  if (src->data) munmap((void *)src->data, src->size);
+  src->data = NULL;
+}
+
+static void cache_path(const CacheSource *src, char *path, size_t size) {
+  if (src->variant) {
+    snprintf(path, size, "%s/%016llx-%llx-%x.tex", cacheDir, src->hash,
+        (unsigned long long)src->mtime, src->variant);
+  } else {
+    snprintf(path, size, "%s/%016llx-%llx.tex", cacheDir, src->hash, (unsigned long long)src->mtime);
+  }
+}
+
+int cache_lookup(const CacheSource *src, TexImage *img) {
+  char path[1100];
+  const CacheHeader *hdr;
+  size_t size;
+
+  if (!cacheDir[0]) return 0;
+  cache_path(src, path, sizeof(path));
+  hdr = map_file(path, &size, NULL);
+  if (!hdr) return 0;
+
+  // Проверка заголовка: повреждённый или чужой файл просто игнорируется
+  if (size < sizeof(CacheHeader) || memcmp(hdr->magic, CACHE_MAGIC, 4)
+      || hdr->version != CACHE_VERSION || hdr->hash != src->hash
+      || hdr->mtime != src->mtime || hdr->variant != src->variant
+      || hdr->levels < 1 || hdr->levels > CACHE_MAX_LEVELS
+      || hdr->width < 1 || hdr->width > CACHE_MAX_SIZE
+      || hdr->height < 1 || hdr->height > CACHE_MAX_SIZE) {
+    munmap((void *)hdr, size);
+    return 0;
+  }
+  memset(img, 0, sizeof(TexImage));
+  img->width = hdr->width;
+  img->height = hdr->height;
+  img->levels = hdr->levels;
+  for (int i = 0; i < img->levels; i++) {
+    int w = img->width >> i > 0 ? img->width >> i : 1;
+    int h = img->height >> i > 0 ? img->height >> i : 1;
+    // Строка не короче ширины уровня, иначе GL читает за концом файла
+    if (hdr->stride[i] < (uint64_t)w * PIX_BPP || hdr->stride[i] % PIX_BPP
+        || hdr->offset[i] > size || (uint64_t)hdr->stride[i] * h > size - hdr->offset[i]) {
+      munmap((void *)hdr, size);
+      return 0;
+    }
+    img->stride[i] = hdr->stride[i];
+    img->level[i] = (unsigned char *)hdr + hdr->offset[i];
+  }
+  img->map = (void *)hdr;
+  img->mapSize = size;
+  return 1;
+}
+
+void cache_store(const CacheSource *src, const TexImage *img) {
+  static const char zero[PIX_ROW_ALIGN];
+  char path[1100], tmp[1200];
+  CacheHeader hdr;
+  uint64_t offset;
+  FILE *f;
+  int ok = 1, fd;
+
+  if (!cacheDir[0]) return;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, CACHE_MAGIC, 4);
+  hdr.version = CACHE_VERSION;
+  hdr.hash = src->hash;
+  hdr.mtime = src->mtime;
+  hdr.variant = src->variant;
+  hdr.width = img->width;
+  hdr.height = img->height;
+  hdr.levels = img->levels;
+  offset = sizeof(hdr);
+  for (int i = 0; i < img->levels; i++) {
+    // Начало каждого уровня выровнено, как и строки в памяти
+    offset = (offset + PIX_ROW_ALIGN - 1) & ~(uint64_t)(PIX_ROW_ALIGN - 1);
+    hdr.offset[i] = offset;
+    hdr.stride[i] = img->stride[i];
+    offset += (uint64_t)img->stride[i] * (img->height >> i > 0 ? img->height >> i : 1);
+  }
+
+  // Запись во временный файл и переименование, чтобы не было полузаписанных файлов
+  cache_path(src, path, sizeof(path));
+  // Своё имя у каждой записи: потоки загрузчика пишут одновременно
+  snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+  fd = mkstemp(tmp);
+  if (fd < 0) return;
+  f = fdopen(fd, "wb");
+  if (!f) {
+    close(fd);
+    remove(tmp);
+    return;
+  }
+  ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+  offset = sizeof(hdr);
+  for (int i = 0; ok && i < img->levels; i++) {
+    size_t len = (size_t)img->stride[i] * (img->height >> i > 0 ? img->height >> i : 1);
+    ok = fwrite(zero, 1, hdr.offset[i] - offset, f) == hdr.offset[i] - offset
+        && fwrite(img->level[i], 1, len, f) == len;
+    offset = hdr.offset[i] + len;
+  }
+  if (fclose(f) || !ok || rename(tmp, path)) remove(tmp);
+}
+
+void tex_build_mips(TexImage *img) {
+  int w = img->width, h = img->height;
+
+  while (img->levels < CACHE_MAX_LEVELS && (w > 1 || h > 1)) {
+    int i = img->levels;
+    int nw = w > 1 ? w / 2 : 1, nh = h > 1 ? h / 2 : 1;
+    unsigned char *dst = pix_alloc(nw, nh, &img->stride[i]);
+    if (!dst) return;
+    for (int y = 0; y < nh; y++) {
+      const unsigned char *r0 = img->level[i - 1] + (size_t)(y * 2) * img->stride[i - 1];
+      const unsigned char *r1 = h > 1 ? r0 + img->stride[i - 1] : r0;
+      unsigned char *d = dst + (size_t)y * img->stride[i];
+      for (int x = 0; x < nw; x++) {
+        int x0 = x * 2 * PIX_BPP, x1 = w > 1 ? x0 + PIX_BPP : x0;
+        for (int c = 0; c < PIX_BPP; c++) {
+          d[x * PIX_BPP + c] = (r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c] + 2) >> 2;
+        }
+      }
+    }
+    img->level[i] = dst;
+    img->levels++;
+    w = nw;
+    h = nh;
+  }
+}
+
+void tex_release(TexImage *img) {
+  if (img->map) {
+    munmap(img->map, img->mapSize);
+  } else {
+    for (int i = 0; i < img->levels; i++) pix_free(img->level[i]);
+  }
+  memset(img, 0, sizeof(TexImage));
+}
@@ -0,0 +1,48 @@
+#ifndef IMGCACHE_H
+#define IMGCACHE_H
+
+#include <stddef.h>
+
+/* Дисковый кэш декодированных изображений. Файл кэша - заголовок и
+   уровни mip в формате pixfmt (BGRA, выровненные строки); имя файла
+   составляется из хэша содержимого исходника и времени его изменения.
+   При повторном запуске файл отображается в память, и текстура
+   загружается прямо из отображения, без декодирования JPEG/PNG. */
+
+#define CACHE_MAX_LEVELS 16
+
+// Готовые к загрузке в GL пиксели: в памяти кучи или в отображении файла
+typedef struct TexImage {
+  int width, height, levels;
+  int stride[CACHE_MAX_LEVELS];
+  unsigned char *level[CACHE_MAX_LEVELS];
+  void *map; // Не NULL, если пиксели лежат в отображённом файле кэша
+  size_t mapSize;
+} TexImage;
+
+// Исходный файл, отображённый в память, и его ключ в кэше
+typedef struct CacheSource {
+  const unsigned char *data;
+  size_t size;
+  unsigned long long hash;
+  long long mtime;
+  unsigned int variant; // Вариант декодирования (например, уменьшенный), 0 - обычный
+} CacheSource;
+
+/* dir == NULL: $IMGCACHE_DIR или ~/.cache/glfw-experiments.
+   mipmaps: хранить в кэше заранее посчитанные уровни mip. */
+void cache_init(const char *dir, int mipmaps);
+extern int cacheMipmaps;
+
+int cache_source_open(const char *filename, CacheSource *src);
+void cache_source_close(CacheSource *src);
+
+// 1, если изображение найдено и отображено в img
+int cache_lookup(const CacheSource *src, TexImage *img);
+void cache_store(const CacheSource *src, const TexImage *img);
+
+// Строит уровни 1.. из уровня 0, уменьшая вдвое усреднением 2x2
+void tex_build_mips(TexImage *img);
+void tex_release(TexImage *img);
+
+#endif
@@ -0,0 +1,91 @@
+#include <pthread.h>
+#include <unistd.h>
+#include "jobpool.h"
+
+#define MAX_THREADS 16
+
+typedef struct Batch {
+  PoolFunc *func;
+  void *task;
+  int count, next, done;
+  pthread_cond_t finished;
+  struct Batch *link;
+} Batch;
+
+static pthread_t threads[MAX_THREADS];
+static int threadCount;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static int quit;
+
+static Batch *batches; // Есть ещё не розданные индексы
+
+// Выполнить следующий индекс пакета; вызывается под lock, возвращает 0, если индексов нет
+static int run_one(Batch *b) {
+  int i;
+
+  if (b->next >= b->count) return 0;
+  i = b->next++;
+  if (b->next == b->count) { // Розданы все - убрать из очереди
+    Batch **p = &batches;
+    while (*p != b) p = &(*p)->link;
+    *p = b->link;
+  }
+  pthread_mutex_unlock(&lock);
+  b->func(b->task, i);
+  pthread_mutex_lock(&lock);
+  if (++b->done == b->count) pthread_cond_signal(&b->finished);
+  return 1;
+}
+
+static void *worker(void *arg) {
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    while (!batches && !quit) pthread_cond_wait(&wake, &lock);
+    if (quit) break;
+    run_one(batches);
+  }
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+void pool_init(int threads_) {
+  if (threads_ <= 0) threads_ = sysconf(_SC_NPROCESSORS_ONLN) - 1; // Вызывающий поток - ещё один
+  if (threads_ > MAX_THREADS) threads_ = MAX_THREADS;
+  quit = 0;
+  for (threadCount = 0; threadCount < threads_; threadCount++) {
+    if (pthread_create(&threads[threadCount], NULL, worker, NULL)) break;
+  }
+}
+
+void pool_shutdown(void) {
+  pthread_mutex_lock(&lock);
+  quit = 1;
+  pthread_cond_broadcast(&wake);
+  pthread_mutex_unlock(&lock);
+  while (threadCount > 0) pthread_join(threads[--threadCount], NULL);
+}
+
+void pool_run(PoolFunc *func, void *task, int count) {
+  Batch b;
+
+  if (count <= 0) return;
+  if (threadCount == 0 || count == 1) {
+    for (int i = 0; i < count; i++) func(task, i);
+    return;
+  }
+  b.func = func;
+  b.task = task;
+  b.count = count;
+  b.next = b.done = 0;
+  pthread_cond_init(&b.finished, NULL);
+
+  pthread_mutex_lock(&lock);
+  b.link = batches;
+  batches = &b;
+  pthread_cond_broadcast(&wake);
+  while (run_one(&b));
+  while (b.done < b.count) pthread_cond_wait(&b.finished, &lock);
+  pthread_mutex_unlock(&lock);
+  pthread_cond_destroy(&b.finished);
+}
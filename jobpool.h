@@ -0,0 +1,18 @@
+#ifndef JOBPOOL_H
+#define JOBPOOL_H
+
+/* Пул потоков для параллельных циклов внутри одной задачи (например,
+   строки MCU при декодировании JPEG). Вызвавший pool_run поток сам
+   тоже выполняет части задачи, поэтому pool_run можно звать из
+   нескольких потоков сразу, в том числе из потоков загрузчика. */
+
+typedef void PoolFunc(void *task, int index);
+
+// threads == 0: по числу процессоров. Без pool_init всё выполняется в вызывающем потоке
+void pool_init(int threads);
+void pool_shutdown(void);
+
+// Вызывает func(task, i) для i = 0..count-1 и ждёт завершения всех вызовов
+void pool_run(PoolFunc *func, void *task, int count);
+
+#endif
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "latency.h"
+
+#define RING (LATENCY_MAX_FRAMES + 1)
+
+typedef struct Frame {
+  GLsync fence; // NULL - кадр уже выполнен или не отправлен
+  double input; // Время чтения ввода
+} Frame;
+
+static Frame ring[RING];
+static int head; // Куда встанет следующий кадр
+static int inFlight;
+static double inputTime;
+static int haveInput;
+
+static int count;
+static double sum, max, waited;
+static double lastReport;
+
+void latency_init(int frames) {
+  if (frames < 1) frames = 1;
+  if (frames > LATENCY_MAX_FRAMES) frames = LATENCY_MAX_FRAMES;
+  inFlight = frames;
+  head = 0;
+  memset(ring, 0, sizeof(ring));
+  haveInput = 0;
+  count = 0;
+  sum = max = waited = 0;
+  lastReport = glfwGetTime();
+}
+
+static void retire(Frame *f, double now) {
+  glDeleteSync(f->fence);
+  f->fence = NULL;
+  if (f->input >= 0) {
+    double d = now - f->input;
+    sum += d;
+    if (d > max) max = d;
+    count++;
+  }
+}
+
+void latency_shutdown(void) {
+  for (int i = 0; i < RING; i++) {
+    if (ring[i].fence) glDeleteSync(ring[i].fence);
+    ring[i].fence = NULL;
+  }
+}
+
+void latency_input(void) {
+  inputTime = glfwGetTime();
+  haveInput = 1;
+}
+
+void latency_frame_end(void) {
+  Frame *f = &ring[head];
+  Frame *old;
+  double now;
+
+  if (f->fence) retire(f, glfwGetTime()); // Не должно случаться: кадр старше ожидаемого
+  f->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  f->input = haveInput ? inputTime : -1;
+  haveInput = 0;
+  head = (head + 1) % RING;
+
+  // Уже выполненные кадры - без ожидания, чтобы время было точнее
+  now = glfwGetTime();
+  for (int i = 0; i < RING; i++) {
+    if (ring[i].fence && glClientWaitSync(ring[i].fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+      retire(&ring[i], now);
+    }
+  }
+
+  // Кадр, отправленный inFlight кадров назад, должен быть выполнен
+  old = &ring[(head + RING - 1 - inFlight) % RING];
+  if (old->fence) {
+    double start = now;
+    GLenum r;
+    do {
+      r = glClientWaitSync(old->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000); // 100 мс
+    } while (r == GL_TIMEOUT_EXPIRED);
+    now = glfwGetTime();
+    waited += now - start;
+    retire(old, now);
+  }
+}
+
+void latency_stats(LatencyStats *s) {
+  s->frames = count;
+  s->average = count ? sum / count : 0;
+  s->max = max;
+  s->wait = waited;
+  count = 0;
+  sum = max = waited = 0;
+}
+
+void latency_report(double interval) {
+  LatencyStats s;
+  double now = glfwGetTime();
+
+  if (now - lastReport < interval) return;
+  lastReport = now;
+  latency_stats(&s);
+  if (s.frames == 0) return;
+  printf("Input latency: %.1f ms average, %.1f ms max over %d frames, %.1f ms waiting on fences"
+      " (%d frames in flight)\n", s.average * 1000, s.max * 1000, s.frames, s.wait * 1000, inFlight);
+}
@@ -0,0 +1,35 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+/* Ограничение числа кадров в очереди драйвера. После отправки каждого
+   кадра ставится glFenceSync, и поток отрисовки ждёт забор кадра,
+   отправленного frames кадров назад. Так драйвер не копит лишние
+   кадры между чтением ввода (glfwGetCursorPos) и выводом на экран.
+
+   Задержка ввода меряется от latency_input до момента, когда забор
+   этого кадра оказался пройден: это время, за которое GPU выполнил
+   кадр, без учёта развёртки монитора. */
+
+#define LATENCY_MAX_FRAMES 3
+
+// frames - от 1 до LATENCY_MAX_FRAMES; нужен текущий GL-контекст
+void latency_init(int frames);
+void latency_shutdown(void);
+
+// Ввод для текущего кадра прочитан
+void latency_input(void);
+// Сразу после glfwSwapBuffers: ставит забор и ждёт старый кадр
+void latency_frame_end(void);
+
+typedef struct LatencyStats {
+  int frames; // Кадров с измеренной задержкой
+  double average, max; // Секунды
+  double wait; // Сколько всего поток отрисовки простоял в ожидании заборов
+} LatencyStats;
+
+// Статистика с прошлого вызова; счётчики сбрасываются
+void latency_stats(LatencyStats *stats);
+// Раз в interval секунд печатает статистику
+void latency_report(double interval);
+
+#endif
@@ -0,0 +1,228 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GLFW/glfw3.h>
+
+#include "pixfmt.h"
+#include "image.h"
+#include "imgcache.h"
+#include "loader.h"
+
+#define MAX_THREADS 16
+
+static pthread_t threads[MAX_THREADS];
+static int threadCount;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static int quit;
+
+static Asset *jobs, *jobsTail; // Ждут декодирования
+static Asset *decoded; // Декодированы, ждут загрузки в GL
+static Asset *uploads, *uploadsTail; // Принадлежат потоку отрисовки
+static int inFlight;
+
+static GLuint placeholder;
+
+// Декодер пишет прямо в уровень 0 будущей текстуры
+static unsigned char *level0(void *user, int width, int height, int *stride) {
+  TexImage *img = user;
+  img->level[0] = pix_alloc(width, height, stride);
+  img->stride[0] = *stride;
+  return img->level[0];
+}
+
+static void decode(Asset *a) {
+  CacheSource src;
+  TexImage *img = &a->image;
+
+  if (!cache_source_open(a->filename, &src)) {
+    printf("Error loading texture '%s'\n", a->filename);
+    return;
+  }
+  if (a->maxWidth > 0 && a->maxHeight > 0) {
+    src.variant = (unsigned int)a->maxWidth << 16 | (a->maxHeight & 0xFFFF);
+  }
+  if (cache_lookup(&src, img)) {
+    cache_source_close(&src);
+    return;
+  }
+
+  if (img_decode_scaled(src.data, src.size, a->maxWidth, a->maxHeight,
+      level0, img, &img->width, &img->height)) {
+    img->levels = 1;
+    if (cacheMipmaps) tex_build_mips(img);
+    cache_store(&src, img);
+  } else {
+    printf("Error loading texture '%s': %s\n", a->filename, img_failure_reason());
+    pix_free(img->level[0]);
+    memset(img, 0, sizeof(TexImage));
+  }
+  cache_source_close(&src);
+}
+
+static void *worker(void *arg) {
+  Asset *a;
+
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    while (!jobs && !quit) pthread_cond_wait(&wake, &lock);
+    if (quit) break;
+    a = jobs;
+    jobs = a->next;
+    if (!jobs) jobsTail = NULL;
+    pthread_mutex_unlock(&lock);
+
+    decode(a);
+    a->width = a->image.width;
+    a->height = a->image.height;
+
+    pthread_mutex_lock(&lock);
+    a->state = ASSET_DECODED;
+    a->next = decoded;
+    decoded = a;
+    glfwPostEmptyEvent(); // Разбудить главный цикл в glfwWaitEvents
+  }
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+void loader_init(int threads_) {
+  static const unsigned int gray[4] = {
+    0xFF808080u, 0xFF606060u, 0xFF606060u, 0xFF808080u
+  };
+
+  placeholder = pix_create_texture(2, 2, gray, 2 * PIX_BPP);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  if (threads_ < 1) threads_ = 1;
+  if (threads_ > MAX_THREADS) threads_ = MAX_THREADS;
+  quit = 0;
+  for (threadCount = 0; threadCount < threads_; threadCount++) {
+    if (pthread_create(&threads[threadCount], NULL, worker, NULL)) break;
+  }
+}
+
+void loader_shutdown(void) {
+  pthread_mutex_lock(&lock);
+  quit = 1;
+  pthread_cond_broadcast(&wake);
+  pthread_mutex_unlock(&lock);
+  while (threadCount > 0) pthread_join(threads[--threadCount], NULL);
+  glDeleteTextures(1, &placeholder);
+}
+
+Asset *loader_request(const char *filename, GLenum filter) {
+  return loader_request_scaled(filename, filter, 0, 0);
+}
+
+Asset *loader_request_scaled(const char *filename, GLenum filter, int maxWidth, int maxHeight) {
+  Asset *a = calloc(1, sizeof(Asset));
+  a->texture = placeholder;
+  a->filename = strdup(filename);
+  a->filter = filter;
+  a->maxWidth = maxWidth;
+  a->maxHeight = maxHeight;
+  a->state = ASSET_PENDING;
+
+  pthread_mutex_lock(&lock);
+  if (jobsTail) jobsTail->next = a; else jobs = a;
+  jobsTail = a;
+  inFlight++;
+  pthread_cond_signal(&wake);
+  pthread_mutex_unlock(&lock);
+  return a;
+}
+
+void loader_free(Asset *a) {
+  if (!a) return;
+  // Ресурс в очереди освобождать нельзя, сначала дождаться loader_finalize
+  if (a->state == ASSET_PENDING || a->state == ASSET_DECODED) return;
+  if (a->texture != placeholder) glDeleteTextures(1, &a->texture);
+  free(a->filename);
+  free(a);
+}
+
+// Загрузка очередной полосы строк, возвращает число загруженных байт
+static size_t upload(Asset *a, size_t budget) {
+  TexImage *img = &a->image;
+  int rows;
+  size_t spent;
+
+  if (!a->uploading) {
+    a->uploading = pix_create_texture(img->width, img->height, NULL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, a->filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, a->filter);
+  }
+
+  rows = budget / img->stride[0];
+  if (rows < 1) rows = 1;
+  if (rows > img->height - a->rowsUploaded) rows = img->height - a->rowsUploaded;
+  pix_upload(a->uploading, 0, a->rowsUploaded, img->width, rows, img->level[0], img->stride[0]);
+  a->rowsUploaded += rows;
+  spent = (size_t)rows * img->stride[0];
+
+  if (a->rowsUploaded == img->height) {
+    if (img->levels > 1) {
+      // Уровни mip из кэша, они вместе меньше трети уровня 0
+      for (int i = 1; i < img->levels; i++) {
+        int w = img->width >> i > 0 ? img->width >> i : 1;
+        int h = img->height >> i > 0 ? img->height >> i : 1;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, img->stride[i] / PIX_BPP);
+        glTexImage2D(GL_TEXTURE_2D, i, pixFormat.internalFormat, w, h, 0,
+            pixFormat.format, pixFormat.type, img->level[i]);
+        spent += (size_t)img->stride[i] * h;
+      }
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, img->levels - 1);
+    } else {
+      glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    tex_release(img);
+    a->texture = a->uploading;
+    a->state = ASSET_READY;
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return spent;
+}
+
+int loader_finalize(size_t budget) {
+  Asset *a, *next;
+  size_t spent = 0;
+  int left;
+
+  pthread_mutex_lock(&lock);
+  for (a = decoded, decoded = NULL; a; a = next) {
+    next = a->next;
+    a->next = NULL;
+    if (uploadsTail) uploadsTail->next = a; else uploads = a;
+    uploadsTail = a;
+  }
+  pthread_mutex_unlock(&lock);
+
+  while (uploads && (spent == 0 || spent < budget)) {
+    a = uploads;
+    if (a->image.levels) {
+      spent += upload(a, budget > spent ? budget - spent : 0);
+      if (a->image.levels) break; // Бюджет исчерпан посреди изображения
+    } else {
+      a->state = ASSET_FAILED;
+    }
+    uploads = a->next;
+    if (!uploads) uploadsTail = NULL;
+    a->next = NULL;
+    pthread_mutex_lock(&lock);
+    inFlight--;
+    pthread_mutex_unlock(&lock);
+  }
+
+  pthread_mutex_lock(&lock);
+  left = inFlight;
+  pthread_mutex_unlock(&lock);
+  return left;
+}
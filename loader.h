@@ -0,0 +1,46 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stddef.h>
+#include <GL/glew.h>
+#include "imgcache.h"
+
+/* Асинхронная загрузка текстур. Изображения декодируются пулом
+   потоков, а загрузка в GL выполняется в потоке отрисовки небольшими
+   порциями через loader_finalize. До окончания загрузки у ресурса
+   texture указывает на текстуру-заглушку. Декодированные изображения
+   сохраняются в дисковом кэше (imgcache), если он включён. */
+
+enum { ASSET_PENDING, ASSET_DECODED, ASSET_READY, ASSET_FAILED };
+
+typedef struct Asset {
+  GLuint texture; // Заглушка, пока изображение не загружено
+  int width, height;
+  volatile int state;
+
+  // Внутреннее состояние загрузчика
+  char *filename;
+  GLenum filter;
+  int maxWidth, maxHeight;
+  TexImage image;
+  int rowsUploaded;
+  GLuint uploading;
+  struct Asset *next;
+} Asset;
+
+#define LOADER_BUDGET (512 * 1024) // Байт загрузки в GL за кадр по умолчанию
+
+// Нужен текущий GL-контекст (создаётся заглушка). Кэш - см. cache_init
+void loader_init(int threads);
+void loader_shutdown(void);
+
+Asset *loader_request(const char *filename, GLenum filter);
+// Не больше maxWidth x maxHeight: JPEG декодируется сразу уменьшенным
+Asset *loader_request_scaled(const char *filename, GLenum filter, int maxWidth, int maxHeight);
+void loader_free(Asset *asset);
+
+/* Загружает в GL готовые изображения, не более budget байт за вызов
+   (хотя бы одну полосу строк). Возвращает число незавершённых ресурсов. */
+int loader_finalize(size_t budget);
+
+#endif
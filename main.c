@@ -2,21 +2,34 @@
 #include <GLFW/glfw3.h>
 #include <stdio.h>
 #include <stdlib.h>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include <string.h>
+
+#include "pixfmt.h"
+#include "jobpool.h"
+#include "loader.h"
+#include "atlas.h"
+#include "postfx.h"
+#include "effects.h"
+#include "latency.h"
+#include "pacing.h"
+#include "capture.h"
+#include "display.h"
 
 #define bufW 320
 #define bufH 200
+#define framesInFlight 1 // 1-3: сколько кадров драйвер может держать в очереди
 
-double winX, winY, winW, winH;
+Display *display;
 
-GLint screenSizeLocation;
 //float projectionMatrix[16];
 
 // Textures
-GLuint manTextureID;
-GLuint cursorTextureID;
+Asset *manTexture;
+Atlas *atlas; // Курсор и прочие мелкие картинки
+AtlasImage *cursorImage;
+
+// Постобработка в логическом разрешении bufW x bufH
+GLuint effectProgram;
 
 char *load_shader_file(const char* fileName) {
   FILE *fp;
@@ -42,41 +55,6 @@ char *load_shader_file(const char* fileName) {
   return shaderContent;
 }
 
-GLuint loadTexture(const char *filename) {
-  int width, height, channels;
-  unsigned char *data = stbi_load(filename, &width, &height, &channels, 0);
-  if (!data) {
-    printf("Error loading texture '%s'\n", filename);
-    exit(1);
-  }
-
-  GLuint textureID;
-  glGenTextures(1, &textureID);
-  glBindTexture(GL_TEXTURE_2D, textureID);
-
-  // Установка параметров текстуры
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-  // Загрузка изображения в текстуру
-  GLenum format = GL_RGB;
-  if (channels == 1) format = GL_RED;
-  else if (channels == 4) format = GL_RGBA;
-
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-  glGenerateMipmap(GL_TEXTURE_2D);
-
-  // Освобождение памяти и отвязка текстуры
-  stbi_image_free(data);
-  glBindTexture(GL_TEXTURE_2D, 0);
-
-  return textureID;
-}
-
 /*
 void makeProjection(float *m, float left, float right, float top, float bottom) {
   float near = -1.0;
@@ -96,237 +74,140 @@ void makeProjection(float *m, float left, float right, float top, float bottom)
 }
 */
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-  glUniform2f(screenSizeLocation, (float)width, (float)height);
-
-  winW = width;
-  winH = height;
-
-  float aspectRatioSource = (float)bufW / (float)bufH;
-  float aspectRatioWindow = (float)width / (float)height;
-
-  int viewportWidth, viewportHeight;
-
-  if (aspectRatioWindow > aspectRatioSource) {
-    viewportHeight = height;
-    viewportWidth = (int)(height * aspectRatioSource);
-  } else {
-    viewportWidth = width;
-    viewportHeight = (int)(width / aspectRatioSource);
+// F12 - снимок экрана, F11 - начать/остановить запись видео
+void key_event(const DisplayEvent *ev) {
+  if (ev->action != GLFW_PRESS) return;
+  if (ev->key == GLFW_KEY_F12) {
+    capture_screenshot("screenshot.png");
+  } else if (ev->key == GLFW_KEY_F11) {
+    if (capture_recording()) capture_stop();
+    else capture_start("capture.y4m", CAPTURE_Y4M, 60);
   }
-
-  int viewportX = (width - viewportWidth) / 2;
-  int viewportY = (height - viewportHeight) / 2;
-
-  glViewport(viewportX, viewportY, viewportWidth, viewportHeight);
-  winX = viewportX;
-  winY = viewportY;
-  winW = viewportWidth;
-  winH = viewportHeight;
-}
-
-void init_graph() {
-  glfwInit();
-}
-
-GLFWwindow *create_window() {
-  GLFWwindow *win;
-
-  // Получение основного монитора
-  GLFWmonitor* primaryMonitor = glfwGetPrimaryMonitor();
-  // Получение режима видео для основного монитора
-  const GLFWvidmode* mode = glfwGetVideoMode(primaryMonitor);
-
-  // Создание окна
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-  glfwWindowHint(GLFW_DECORATED, GLFW_FALSE); // Окно без рамки
-  glfwWindowHint(GLFW_AUTO_ICONIFY, GLFW_FALSE); // Без автосворачивания
-  win = glfwCreateWindow(mode->width, mode->height, "Program", primaryMonitor, NULL);
-  //win = glfwCreateWindow(1000, 500, "Program", NULL, NULL);
-  if (!win) {
-    printf("Failed to create GLFW window\n");
-    glfwTerminate();
-    return NULL;
-  }
-  glfwSetFramebufferSizeCallback(win, framebuffer_size_callback);
-  //glfwSetInputMode(win, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
-  glfwMakeContextCurrent(win);
-  glfwSwapInterval(0);
-
-  if (glewInit() != GLEW_OK) {
-    printf("Failed to initialize GLEW\n");
-    return NULL;
-  }
-
-  return win;
-}
-
-GLuint compileShader(GLenum type, const char* source) {
-  // Создание шейдера
-  GLuint shader = glCreateShader(type);
-  glShaderSource(shader, 1, &source, NULL);
-  glCompileShader(shader);
-
-  // Проверка на ошибки компиляции
-  GLint success;
-  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-  if (!success) {
-    char infoLog[512];
-    glGetShaderInfoLog(shader, 512, NULL, infoLog);
-    fprintf(stderr, "Ошибка компиляции шейдера: %s\n", infoLog);
-  }
-
-  return shader;
 }
 
 GLuint createShaderProgram() {
   char *vertexSource = load_shader_file("shaders/vertex.txt");
   char *fragmentSource = load_shader_file("shaders/fragment.txt");
 
-  // Компиляция шейдеров
-  GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
-  GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
-
-  // Создание программы и прикрепление шейдеров к ней
-  GLuint shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-  glLinkProgram(shaderProgram);
-
-  // Проверка на ошибки линковки
-  GLint success;
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-  if (!success) {
-    char infoLog[512];
-    glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-    fprintf(stderr, "Ошибка линковки программы: %s\n", infoLog);
-  }
-
-  // Удаление шейдеров после линковки
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
-
-  return shaderProgram;
-}
-
-void close_buffers(GLuint *VAO, GLuint *VBO, GLuint *EBO) {
-  glDeleteVertexArrays(1, VAO);
-  glDeleteBuffers(1, VBO);
-  glDeleteBuffers(1, EBO);
+  return display_program(vertexSource, fragmentSource);
 }
 
-void init_buffers(GLuint *VAO, GLuint *VBO, GLuint *EBO) {
-  // Определение вершин прямоугольника и текстурных координат
-  float vertices[] = {
-    // позиции | текстурные координаты
-     1,  1,      1, 0, // верхний правый угол
-     1, -1,      1, 1, // нижний правый угол
-    -1, -1,      0, 1, // нижний левый угол
-    -1,  1,      0, 0  // верхний левый угол
-  };
-  unsigned int indices[] = {
-    0, 1, 3, // первый треугольник
-    1, 2, 3  // второй треугольник
-  };
-
-  glGenVertexArrays(1, VAO);
-  glGenBuffers(1, VBO);
-  glGenBuffers(1, EBO);
-
-  glBindVertexArray(*VAO);
-
-  glBindBuffer(GL_ARRAY_BUFFER, *VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-  // Позиционные атрибуты
-  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
-  glEnableVertexAttribArray(0);
-
-  // Текстурные атрибуты
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
-  glEnableVertexAttribArray(1);
-}
-
-void run(GLFWwindow *win, GLuint shaderProgram, GLuint VAO) {
-  GLint timeLocation = glGetUniformLocation(shaderProgram, "time");
+void run(Display *d, GLuint shaderProgram) {
   GLint cursorPosLocation = glGetUniformLocation(shaderProgram, "cursorPos");
   GLint screenLocation = glGetUniformLocation(shaderProgram, "screen");
-  GLint cursorLocation = glGetUniformLocation(shaderProgram, "cursor");
+  GLint atlasLocation = glGetUniformLocation(shaderProgram, "atlas");
+  GLint cursorUVLocation = glGetUniformLocation(shaderProgram, "cursorUV");
   //GLint projectionLocation = glGetUniformLocation(shaderProgram, "projection");
+  GLint screenSizeLocation = glGetUniformLocation(shaderProgram, "screenSize");
+  DisplayEvent ev;
   double x, y;
 
-  screenSizeLocation = glGetUniformLocation(shaderProgram, "screenSize");
-
   //makeProjection(projectionMatrix, 0, bufW, 0, bufH);
 
   glUseProgram(shaderProgram);
-  int w, h;
-  glfwGetFramebufferSize(win, &w, &h);
-  framebuffer_size_callback(win, w, h);
+  latency_init(framesInFlight);
+  capture_init();
+  pace_init(glfwGetVideoMode(glfwGetPrimaryMonitor())->refreshRate);
+
+  while (!glfwWindowShouldClose(d->win)) {
+    while (NextEvent(d, &ev, 0)) {
+      if (ev.type == EVENT_KEY) key_event(&ev);
+    }
+
+    // Ранняя часть кадра: всё, что не зависит от ввода
+
+    // Догрузка текстур, декодированных в фоне
+    glActiveTexture(GL_TEXTURE0);
+    loader_finalize(LOADER_BUDGET);
+
+    // Эффекты - на кадре 320x200, а не на всём экране
+    glActiveTexture(GL_TEXTURE2);
+    effect_update(glfwGetTime()); // Таблица остаётся привязанной к блоку 2
+    GLuint frame = post_run(manTexture->texture);
 
-  while (!glfwWindowShouldClose(win)) {
     glClearColor(0, 0, 0, 1.0);
     glClear(GL_COLOR_BUFFER_BIT);
 
     glUseProgram(shaderProgram);
-    glBindVertexArray(VAO);
 
+    glUniform2f(screenSizeLocation, (float)d->winW, (float)d->winH);
     glUniform1i(screenLocation, 0);
-    glUniform1i(cursorLocation, 1);
+    glUniform1i(atlasLocation, 1);
+    if (cursorImage) {
+      glUniform4f(cursorUVLocation, cursorImage->u0, cursorImage->v0, cursorImage->u1, cursorImage->v1);
+    }
 
     //glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, projectionMatrix);
 
-    glUniform1f(timeLocation, glfwGetTime());
-    glfwGetCursorPos(win, &x, &y);
-    x = (x - winX) / winW * (winW + 2 * winX);
-    y = (y - winY) / winH * (winH + 2 * winY);
-    glUniform2f(cursorPosLocation, (float)x, (float)y);
-
     // Привязка текстур
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, manTextureID);
+    glBindTexture(GL_TEXTURE_2D, frame);
 
+    // Одна привязка на все картинки атласа
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, cursorTextureID);
+    atlas_flush(atlas);
+    glBindTexture(GL_TEXTURE_2D, atlas_texture(atlas, 0));
+    glActiveTexture(GL_TEXTURE0);
+
+    // Поздняя часть: курсор читается как можно ближе к выводу на экран
+    pace_wait();
+    glfwGetCursorPos(d->win, &x, &y);
+    latency_input();
+    x = (x - d->viewX) / d->viewW * (d->viewW + 2 * d->viewX);
+    y = (y - d->viewY) / d->viewH * (d->viewH + 2 * d->viewY);
+    glUniform2f(cursorPosLocation, (float)x, (float)y);
 
     // Прорисовка
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    display_draw_quad(d);
+    capture_frame(d->viewX, d->viewY, d->viewW, d->viewH);
 
     // Отображение результата
-    glfwSwapBuffers(win);
-
-    glfwWaitEventsTimeout(1.0 / 60);
+    glfwSwapBuffers(d->win);
+    latency_frame_end();
+    pace_frame_end();
+    latency_report(5.0);
   }
+  latency_shutdown();
+  capture_shutdown();
 }
 
 int main() {
-  GLFWwindow *win;
-  GLuint VBO, VAO, EBO;
-
-  init_graph();
-  win = create_window();
-  if (!win) return 1;
+  // Окно, контекст и прямоугольник вывода - из libobdisplay (display.c)
+  display = OpenDisplay(bufW, bufH, DISPLAY_FULLSCREEN | DISPLAY_INTEGER_SCALE);
+  if (!display) return 1;
 
   // Шейдер
   GLuint shaderProgram = createShaderProgram();
 
-  init_buffers(&VAO, &VBO, &EBO);
-
-  // Загрузка текстур
-  manTextureID = loadTexture("images/man_320.jpg");
-  cursorTextureID = loadTexture("images/arrow.png");
-
-  run(win, shaderProgram, VAO);
-
-  close_buffers(&VAO, &VBO, &EBO);
+  post_init(bufW, bufH);
+  effectProgram = post_program(load_shader_file("shaders/effect.txt"));
+  post_add_pass(effectProgram, 1, GL_NEAREST);
+  effect_init(128, 80);
+  glUseProgram(effectProgram);
+  glUniform1i(glGetUniformLocation(effectProgram, "lut"), 2);
+
+  // Загрузка текстур в фоне, до её окончания рисуются заглушки
+  cache_init(NULL, 0);
+  pool_init(0); // Потоки для декодирования одного изображения по частям
+  loader_init(4);
+  manTexture = loader_request("images/man_320.jpg", GL_NEAREST);
+  atlas = atlas_create(256, 256, 1, GL_NEAREST);
+  cursorImage = atlas_load(atlas, "images/arrow.png");
+
+  run(display, shaderProgram);
+
+  while (loader_finalize(LOADER_BUDGET) > 0) glfwWaitEventsTimeout(0.01);
+  loader_free(manTexture);
+  atlas_destroy(atlas);
+  loader_shutdown();
+  pool_shutdown();
+
+  effect_shutdown();
+  post_shutdown();
+  glDeleteProgram(effectProgram);
   glDeleteProgram(shaderProgram);
 
-  glfwTerminate();
+  Close(display);
   return 0;
 }
 
@@ -2,6 +2,7 @@
 #include <GLFW/glfw3.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "pixfmt.h"
 
 #define WIDTH 320 // Исходная ширина растра
 #define HEIGHT 200 // Исходная высота растра
@@ -38,16 +39,19 @@ const char* fragmentShaderSource = "#version 330 core\n"
   "   }\n"
   "}\0";
 
-unsigned char pixels[WIDTH * HEIGHT * 3]; // Массив пикселей для текстуры
+unsigned char *pixels; // Пиксели текстуры в формате BGRA
+int pixelsStride; // Длина строки в байтах
 
 void initPixels() {
   // Заполнение массива пикселей
-  int i = 0;
+  pixels = pix_alloc(WIDTH, HEIGHT, &pixelsStride);
   for (int y = 0; y < HEIGHT; ++y) {
+    unsigned int *row = (unsigned int *)(pixels + y * pixelsStride);
     for (int x = 0; x < WIDTH; ++x) {
-      pixels[i++] = (y * 1024 / (x + 1)) % 256; // Красный
-      pixels[i++] = x * y; // Зеленый
-      pixels[i++] = (x * 1024 / (y + 1)) % 256; // Синий
+      unsigned char r = (y * 1024 / (x + 1)) % 256; // Красный
+      unsigned char g = x * y; // Зеленый
+      unsigned char b = (x * 1024 / (y + 1)) % 256; // Синий
+      row[x] = 0xFF000000u | r << 16 | g << 8 | b;
     }
   }
 }
@@ -103,6 +107,7 @@ int main() {
     fprintf(stderr, "Failed to initialize GLEW\n");
     return -1;
   }
+  pix_init_format();
 
   initPixels();
 
@@ -170,13 +175,9 @@ int main() {
   glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
   glEnableVertexAttribArray(1);
 
-  GLuint texture;
-  glGenTextures(1, &texture);
-  glBindTexture(GL_TEXTURE_2D, texture);
+  GLuint texture = pix_create_texture(WIDTH, HEIGHT, pixels, pixelsStride);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, WIDTH, HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
 
   GLint cursorPosLocation = glGetUniformLocation(shaderProgram, "cursorPos");
   GLint cursorSizeLocation = glGetUniformLocation(shaderProgram, "cursorSize");
@@ -198,6 +199,7 @@ int main() {
     glfwPollEvents();
   }
 
+  pix_free(pixels);
   glfwTerminate();
   return 0;
 }
@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pixfmt.h"
+#include "monitors.h"
+
+static MonitorSet *active; // У glfwSetMonitorCallback нет своего указателя
+
+static void *present_thread(void *arg) {
+  Monitor *m = arg;
+  Display *d = m->display;
+  DisplayRect all = { 0, 0, d->width, d->height }, rects[MONITOR_RECTS];
+  unsigned char *pixels;
+  int count;
+
+  glfwMakeContextCurrent(d->win);
+  glfwSwapInterval(1); // Ожидание обновления своего экрана - только в этом потоке
+  pthread_mutex_lock(&m->lock);
+  for (;;) {
+    while (!m->pendingCount && !m->redraw && !m->quit) pthread_cond_wait(&m->wake, &m->lock);
+    if (m->quit) break;
+    // Заполненный буфер - этому потоку, monitor_flush дальше пишет в другой
+    count = m->pendingCount;
+    if (count) {
+      pixels = m->staging;
+      m->staging = m->uploading;
+      m->uploading = pixels;
+    }
+    if (count > 0) memcpy(rects, m->pending, count * sizeof(DisplayRect));
+    m->pendingCount = 0;
+    m->redraw = 0;
+    glViewport(m->viewX, m->viewY, m->viewW, m->viewH);
+    pthread_mutex_unlock(&m->lock);
+
+    // Загрузка без lock: monitor_flush тем временем не ждёт
+    if (count < 0) pix_upload(d->texture, all.x, all.y, all.w, all.h, m->uploading, m->stagingStride);
+    for (int i = 0; i < count; i++) {
+      pix_upload(d->texture, rects[i].x, rects[i].y, rects[i].w, rects[i].h, m->uploading, m->stagingStride);
+    }
+    glClearColor(0, 0, 0, 1.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glUseProgram(d->program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, d->texture);
+    display_draw_quad(d);
+    glfwSwapBuffers(d->win);
+
+    pthread_mutex_lock(&m->lock);
+    m->frames++;
+  }
+  pthread_mutex_unlock(&m->lock);
+  glfwMakeContextCurrent(NULL);
+  return NULL;
+}
+
+static Monitor *add_monitor(MonitorSet *s, GLFWmonitor *monitor) {
+  Monitor *m = calloc(1, sizeof(Monitor)), **p;
+  Display *d;
+
+  if (!m) return NULL;
+  m->monitor = monitor;
+  m->display = d = display_open_monitor(monitor, s->flags & ~MONITORS_ALL, s->root->win);
+  // Окно открылось с текущим контекстом - он нужен потоку вывода
+  glfwMakeContextCurrent(s->root->win);
+  if (d) {
+    m->staging = pix_alloc(d->width, d->height, &m->stagingStride);
+    m->uploading = pix_alloc(d->width, d->height, &m->stagingStride);
+  }
+  if (!d || !m->staging || !m->uploading) {
+    pix_free(m->staging);
+    pix_free(m->uploading);
+    if (d) Close(d);
+    glfwMakeContextCurrent(s->root->win);
+    free(m);
+    return NULL;
+  }
+  memset(m->staging, 0, (size_t)m->stagingStride * d->height);
+  memset(m->uploading, 0, (size_t)m->stagingStride * d->height);
+  m->viewX = d->viewX;
+  m->viewY = d->viewY;
+  m->viewW = d->viewW;
+  m->viewH = d->viewH;
+  m->pendingCount = -1; // Первый кадр
+  pthread_mutex_init(&m->lock, NULL);
+  pthread_cond_init(&m->wake, NULL);
+  if (pthread_create(&m->thread, NULL, present_thread, m)) {
+    fprintf(stderr, "monitors: не удалось запустить поток вывода\n");
+    pthread_mutex_destroy(&m->lock);
+    pthread_cond_destroy(&m->wake);
+    pix_free(m->staging);
+    pix_free(m->uploading);
+    Close(d);
+    glfwMakeContextCurrent(s->root->win);
+    free(m);
+    return NULL;
+  }
+  for (p = &s->monitors; *p; p = &(*p)->next);
+  *p = m;
+  return m;
+}
+
+static void remove_monitor(MonitorSet *s, Monitor *m) {
+  Monitor **p;
+
+  for (p = &s->monitors; *p && *p != m; p = &(*p)->next);
+  if (*p) *p = m->next;
+  pthread_mutex_lock(&m->lock);
+  m->quit = 1;
+  pthread_cond_signal(&m->wake);
+  pthread_mutex_unlock(&m->lock);
+  pthread_join(m->thread, NULL);
+  pthread_mutex_destroy(&m->lock);
+  pthread_cond_destroy(&m->wake);
+  pix_free(m->staging);
+  pix_free(m->uploading);
+  Close(m->display);
+  glfwMakeContextCurrent(s->root->win);
+  free(m);
+}
+
+static void monitor_callback(GLFWmonitor *monitor, int event) {
+  MonitorSet *s = active;
+  Monitor *m;
+
+  if (!s) return;
+  if (event == GLFW_CONNECTED) {
+    if (!(s->flags & MONITORS_ALL) && s->monitors) return;
+    if (!(s->flags & MONITORS_ALL)) monitor = glfwGetPrimaryMonitor();
+  } else {
+    for (m = s->monitors; m && m->monitor != monitor; m = m->next);
+    if (!m) return;
+    if (s->callback) s->callback(s, m, 0, s->ctx);
+    remove_monitor(s, m);
+    // Только основной: окно - на новый основной монитор
+    if (s->flags & MONITORS_ALL || !(monitor = glfwGetPrimaryMonitor())) return;
+  }
+  m = add_monitor(s, monitor);
+  if (m && s->callback) s->callback(s, m, 1, s->ctx);
+}
+
+MonitorSet *monitors_open(int flags, MonitorCallback *callback, void *ctx) {
+  MonitorSet *s;
+  GLFWmonitor **list, *primary;
+  int count;
+
+  if (active) return NULL;
+  s = calloc(1, sizeof(MonitorSet));
+  if (!s) return NULL;
+  s->flags = flags;
+  s->callback = callback;
+  s->ctx = ctx;
+  s->root = OpenDisplay(1, 1, DISPLAY_HIDDEN);
+  if (!s->root) {
+    free(s);
+    return NULL;
+  }
+  list = glfwGetMonitors(&count);
+  primary = glfwGetPrimaryMonitor();
+  for (int i = 0; i < count; i++) {
+    if (flags & MONITORS_ALL || list[i] == primary) add_monitor(s, list[i]);
+  }
+  if (!s->monitors) {
+    monitors_close(s);
+    return NULL;
+  }
+  active = s;
+  glfwSetMonitorCallback(monitor_callback);
+  return s;
+}
+
+void monitors_close(MonitorSet *s) {
+  if (!s) return;
+  if (active == s) {
+    glfwSetMonitorCallback(NULL);
+    active = NULL;
+  }
+  while (s->monitors) remove_monitor(s, s->monitors);
+  Close(s->root);
+  free(s);
+}
+
+void monitor_flush(Monitor *m, const DisplayRect *rects, int count) {
+  Display *d = m->display;
+  DisplayRect all = { 0, 0, d->width, d->height }, r;
+
+  if (count <= 0) {
+    rects = &all;
+    count = 1;
+  }
+  pthread_mutex_lock(&m->lock);
+  for (int i = 0; i < count; i++) {
+    int x0 = rects[i].x > 0 ? rects[i].x : 0, y0 = rects[i].y > 0 ? rects[i].y : 0;
+    int x1 = rects[i].x + rects[i].w, y1 = rects[i].y + rects[i].h;
+    if (x1 > d->width) x1 = d->width;
+    if (y1 > d->height) y1 = d->height;
+    if (x1 <= x0 || y1 <= y0) continue;
+    r = (DisplayRect){ x0, y0, x1 - x0, y1 - y0 };
+    if (m->pendingCount == MONITOR_RECTS) {
+      // Загружаться будет весь кадр, а в буфере только свои прямоугольники
+      r = all;
+      m->pendingCount = -1;
+    } else if (m->pendingCount >= 0) {
+      m->pending[m->pendingCount++] = r;
+    }
+    for (int y = r.y; y < r.y + r.h; y++) {
+      memcpy(m->staging + (size_t)y * m->stagingStride + r.x * 4,
+          d->pixels + (size_t)y * d->stride + r.x * 4, (size_t)r.w * 4);
+    }
+  }
+  pthread_cond_signal(&m->wake);
+  pthread_mutex_unlock(&m->lock);
+}
+
+// Событие из очереди окна любого монитора
+static int pop_event(MonitorSet *s, Monitor **m, DisplayEvent *event) {
+  for (Monitor *p = s->monitors; p; p = p->next) {
+    Display *d = p->display;
+    if (d->head == d->tail) continue;
+    *event = d->queue[d->head];
+    d->head = (d->head + 1) % DISPLAY_QUEUE;
+    *m = p;
+    return 1;
+  }
+  return 0;
+}
+
+int monitors_next_event(MonitorSet *s, Monitor **m, DisplayEvent *event, int timeoutMs) {
+  if (!pop_event(s, m, event)) {
+    if (timeoutMs < 0) glfwWaitEvents();
+    else if (timeoutMs > 0) glfwWaitEventsTimeout(timeoutMs / 1000.0);
+    else glfwPollEvents();
+    // Размеры окон меняются в обработке событий - потокам вывода
+    for (Monitor *p = s->monitors; p; p = p->next) {
+      Display *d = p->display;
+      pthread_mutex_lock(&p->lock);
+      if (p->viewX != d->viewX || p->viewY != d->viewY || p->viewW != d->viewW || p->viewH != d->viewH) {
+        p->redraw = 1; // Вывести заново на новом месте, текстура та же
+        pthread_cond_signal(&p->wake);
+      }
+      p->viewX = d->viewX;
+      p->viewY = d->viewY;
+      p->viewW = d->viewW;
+      p->viewH = d->viewH;
+      pthread_mutex_unlock(&p->lock);
+    }
+    if (!pop_event(s, m, event)) {
+      event->type = EVENT_NONE;
+      *m = NULL;
+      return 0;
+    }
+  }
+  return 1;
+}
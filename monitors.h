@@ -0,0 +1,76 @@
+#ifndef MONITORS_H
+#define MONITORS_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "display.h"
+
+/* Вывод на несколько мониторов. На каждом выбранном мониторе - своё
+   окно (полноэкранное или без рамки) и свой кадр по размеру режима
+   монитора; объекты GL у окон общие с контекстом скрытого окна root,
+   который остаётся текущим в главном потоке.
+
+   Кадр каждого монитора выводится в своём потоке со своей
+   синхронизацией с обновлением экрана: monitor_flush только копирует
+   изменённые места кадра в промежуточный буфер и будит поток, а тот
+   меняет буферы местами и загружает их в текстуру уже без lock, так
+   что следующий monitor_flush не ждёт загрузки. Медленный вывод на одном
+   мониторе поэтому не задерживает ни другие мониторы, ни главный
+   поток. Flush и ScrollRect для кадров мониторов не годятся: контекст
+   окна занят потоком вывода.
+
+   Подключение и отключение мониторов отслеживаются: с MONITORS_ALL на
+   новом мониторе открывается окно, а окно отключённого закрывается;
+   без него окно переезжает на новый основной монитор, если старый
+   отключён. О каждом изменении сообщает callback, об отключении - до
+   закрытия окна. Набор мониторов - один на процесс. */
+
+#define MONITORS_ALL 0x100 // Все мониторы, иначе только основной
+#define MONITOR_RECTS 64 // Больше прямоугольников - весь кадр
+
+typedef struct Monitor {
+  GLFWmonitor *monitor;
+  Display *display; // Кадр - display->pixels, события - в очереди display
+  unsigned char *staging; // Сюда пишет monitor_flush (под lock)
+  unsigned char *uploading; // Отсюда загружает поток вывода
+  int stagingStride;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  // Под lock
+  DisplayRect pending[MONITOR_RECTS];
+  int pendingCount; // -1 - весь кадр
+  int redraw; // Вывести заново без загрузки
+  int viewX, viewY, viewW, viewH; // Область вывода в окне
+  int quit;
+  uint64_t frames; // Выведено кадров
+  struct Monitor *next;
+} Monitor;
+
+typedef struct MonitorSet MonitorSet;
+
+// connected: 1 - монитор добавлен, 0 - сейчас будет закрыт
+typedef void MonitorCallback(MonitorSet *s, Monitor *m, int connected, void *ctx);
+
+struct MonitorSet {
+  int flags;
+  Display *root; // Скрытое окно: общий контекст для главного потока
+  Monitor *monitors;
+  MonitorCallback *callback;
+  void *ctx;
+};
+
+/* flags - MONITORS_ALL и флаги OpenDisplay (DISPLAY_BORDERLESS).
+   NULL, если набор уже открыт или мониторов нет. */
+MonitorSet *monitors_open(int flags, MonitorCallback *callback, void *ctx);
+void monitors_close(MonitorSet *s);
+
+// Передаёт прямоугольники кадра (count == 0 - весь кадр) потоку вывода монитора
+void monitor_flush(Monitor *m, const DisplayRect *rects, int count);
+
+/* Следующее событие любого окна (как NextEvent), *m - его монитор.
+   Подключение и отключение мониторов обрабатываются здесь же. */
+int monitors_next_event(MonitorSet *s, Monitor **m, DisplayEvent *event, int timeoutMs);
+
+#endif
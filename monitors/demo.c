@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../monitors.h"
+
+/* По окну на каждый монитор, у каждого свой кадр и свой поток вывода.
+   По кадрам бегут полосы; раз в секунду печатается, сколько кадров
+   вывел каждый монитор. Мониторы можно подключать и отключать на ходу.
+   ./demo [-borderless] [-primary] */
+
+static void on_monitor(MonitorSet *s, Monitor *m, int connected, void *ctx) {
+  printf("%s: %s, %dx%d\n", connected ? "Подключён" : "Отключён", glfwGetMonitorName(m->monitor),
+      m->display->width, m->display->height);
+}
+
+static void draw(Monitor *m, int frame, DisplayRect *r) {
+  Display *d = m->display;
+  int x = frame * 8 % d->width, px = frame > 0 ? (frame - 1) * 8 % d->width : x;
+
+  // Изменено место старой и новой полосы; при переходе через край - весь кадр
+  *r = px <= x ? (DisplayRect){ px, 0, x + 64 - px, d->height } : (DisplayRect){ 0, 0, d->width, d->height };
+  if (r->x + r->w > d->width) r->w = d->width - r->x;
+  for (int y = 0; y < d->height; y++) {
+    unsigned int *row = (unsigned int *)(d->pixels + (size_t)y * d->stride);
+    for (int i = r->x; i < r->x + r->w; i++) {
+      row[i] = i >= x && i < x + 64 ? 0xFF0000C0 | (y * 255 / d->height) << 8 : 0xFF000000;
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  int flags = MONITORS_ALL, quit = 0, frame = 0;
+  MonitorSet *s;
+  Monitor *m;
+  DisplayEvent ev;
+  double last;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-borderless")) flags |= DISPLAY_BORDERLESS;
+    else if (!strcmp(argv[i], "-primary")) flags &= ~MONITORS_ALL;
+  }
+  s = monitors_open(flags, on_monitor, NULL);
+  if (!s) return 1;
+  for (m = s->monitors; m; m = m->next) on_monitor(s, m, 1, NULL);
+
+  last = glfwGetTime();
+  while (!quit) {
+    // Ожидание - не больше 4 мс, дальше только то, что уже пришло
+    for (int timeout = 4; monitors_next_event(s, &m, &ev, timeout); timeout = 0) {
+      if (ev.type == EVENT_CLOSE) quit = 1;
+      else if (ev.type == EVENT_KEY && ev.key == GLFW_KEY_ESCAPE) quit = 1;
+    }
+    // Главный поток не ждёт ни одного экрана: monitor_flush только копирует
+    for (m = s->monitors; m; m = m->next) {
+      DisplayRect r;
+      draw(m, frame, &r);
+      monitor_flush(m, &r, 1);
+    }
+    frame++;
+
+    if (glfwGetTime() - last >= 1) {
+      for (m = s->monitors; m; m = m->next) {
+        pthread_mutex_lock(&m->lock);
+        printf("%s: %llu кадров/с  ", glfwGetMonitorName(m->monitor), (unsigned long long)m->frames);
+        m->frames = 0;
+        pthread_mutex_unlock(&m->lock);
+      }
+      printf("\n");
+      last = glfwGetTime();
+    }
+  }
+
+  monitors_close(s);
+  return 0;
+}
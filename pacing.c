@@ -0,0 +1,158 @@
+#include <math.h>
+#include <GLFW/glfw3.h>
+
+#include "pacing.h"
+
+#define HISTORY 16 // Кадров в истории длительности поздней части
+#define MARGIN 0.001 // Запас к предсказанию, секунды
+#define MISS_WINDOW 60 // Промахи считаются в окне из стольких кадров
+#define MISS_LIMIT 3 // Столько промахов в окне - возврат к синхронизации
+#define VSYNC_FRAMES 30 // Кадров с синхронизацией до первой попытки пейсинга
+#define VSYNC_FRAMES_MAX 1200
+#define RECAL_FRAMES 300 // Кадров пейсинга между проверками сетки
+#define RECAL_VSYNC 8 // Кадров с синхронизацией в проверке
+#define FIT_MAX 4096 // Столько точек - подгонка начинается заново
+
+static double period; // Период обновления экрана
+static double phase; // Время какого-то из обновлений экрана
+static double history[HISTORY];
+static int historyCount, historyNext;
+static double lateStart, deadline;
+static int vsync;
+static int vsyncFrames, vsyncTarget; // Сколько уже и сколько всего кадров с синхронизацией сейчас
+static int vsyncLength; // Кадров с синхронизацией после промахов
+static double checkPeriod, checkPhase; // Сетка до проверки
+static int check; // Идёт проверка сетки
+static int frames, misses, paced;
+// Подгонка t = fitStart + a + period * k по возвратам из glfwSwapBuffers
+static double fitStart, sk, st, skk, skt;
+static long lastK;
+static int fitCount;
+
+static void set_vsync(int on, int length) {
+  vsync = on;
+  check = 0;
+  glfwSwapInterval(on);
+  vsyncFrames = 0;
+  vsyncTarget = length;
+  checkPeriod = period;
+  checkPhase = phase;
+  frames = misses = paced = 0;
+  historyCount = historyNext = 0; // С синхронизацией в историю попадает ожидание обновления
+}
+
+/* Возврат из glfwSwapBuffers с синхронизацией - около обновления экрана:
+   номер обновления k по текущей сетке, затем наименьшие квадраты по всем
+   точкам. Частота из режима монитора - только начальное приближение:
+   у 59.94 Гц она 60, и сетка по ней за секунды уходит на целый кадр. */
+static void calibrate(double t) {
+  long k;
+  double a, d;
+
+  if (fitCount == 0 || fitCount >= FIT_MAX) {
+    fitStart = t;
+    k = 0;
+    sk = st = skk = skt = 0;
+    fitCount = 0;
+  } else {
+    k = lround((t - phase) / period); // phase - обновление с k = 0
+    // Не дождался обновления (буферизация драйвера) - точка ничего не говорит
+    if (k <= lastK) return;
+    // Сетка не та (сон системы, другой режим): подгонка заново с этой точки
+    if (fitCount >= 2 && fabs(t - (phase + period * lround((t - phase) / period))) > period / 4) {
+      fitCount = 0;
+      calibrate(t);
+      return;
+    }
+  }
+  lastK = k;
+  fitCount++;
+  sk += k;
+  st += t - fitStart;
+  skk += (double)k * k;
+  skt += k * (t - fitStart);
+  d = fitCount * skk - sk * sk;
+  if (fitCount >= 2 && d > 0) {
+    period = (fitCount * skt - sk * st) / d;
+    a = (st - period * sk) / fitCount;
+    phase = fitStart + a;
+  } else {
+    phase = t;
+  }
+}
+
+void pace_init(double refresh) {
+  period = 1.0 / (refresh > 0 ? refresh : 60);
+  phase = glfwGetTime();
+  fitCount = 0;
+  vsyncLength = VSYNC_FRAMES;
+  set_vsync(1, vsyncLength);
+}
+
+// Худшая из недавних длительностей поздней части
+static double predict(void) {
+  double m = 0;
+
+  if (historyCount == 0) return period / 4;
+  for (int i = 0; i < historyCount; i++) {
+    if (history[i] > m) m = history[i];
+  }
+  return m + MARGIN;
+}
+
+void pace_wait(void) {
+  double now = glfwGetTime(), need, wake;
+
+  if (vsync) {
+    lateStart = now;
+    return;
+  }
+  // Ближайшее обновление экрана, к которому поздняя часть ещё успевает
+  need = predict();
+  deadline = phase + ceil((now + need - phase) / period) * period;
+  wake = deadline - need;
+  while ((now = glfwGetTime()) < wake) glfwWaitEventsTimeout(wake - now);
+  lateStart = now;
+}
+
+void pace_frame_end(void) {
+  double now = glfwGetTime(), drift;
+
+  if (vsync) {
+    calibrate(now);
+    if (++vsyncFrames < vsyncTarget) return;
+    /* Промахи пейсинга считаются по его же сетке и ухода сетки не видят:
+       его видно по новой подгонке. Ушла больше чем на запас - кадры
+       приходили не к тем обновлениям, и это тоже промах. */
+    drift = phase - (checkPhase + checkPeriod * round((phase - checkPhase) / checkPeriod));
+    if (check && fabs(drift) > MARGIN) {
+      if (vsyncLength < VSYNC_FRAMES_MAX) vsyncLength *= 2;
+      set_vsync(1, vsyncLength);
+      return;
+    }
+    set_vsync(0, 0);
+    return;
+  }
+
+  history[historyNext] = now - lateStart;
+  historyNext = (historyNext + 1) % HISTORY;
+  if (historyCount < HISTORY) historyCount++;
+
+  if (now > deadline) misses++;
+  if (misses >= MISS_LIMIT) {
+    // Не успеваем: синхронизация, и следующая попытка - вдвое позже
+    if (vsyncLength < VSYNC_FRAMES_MAX) vsyncLength *= 2;
+    set_vsync(1, vsyncLength);
+  } else if (++paced >= RECAL_FRAMES) {
+    // Проверка сетки: несколько кадров с синхронизацией уточняют подгонку
+    set_vsync(1, RECAL_VSYNC);
+    check = 1;
+  } else if (++frames >= MISS_WINDOW) {
+    frames = misses = 0;
+    if (vsyncLength > VSYNC_FRAMES) vsyncLength /= 2;
+  }
+}
+
+int pace_vsync(void) {
+  return vsync;
+}
@@ -0,0 +1,30 @@
+#ifndef PACING_H
+#define PACING_H
+
+/* Подстройка кадра под обновление экрана с поздним чтением ввода.
+   Кадр делится на раннюю часть (эффекты, внеэкранные проходы, загрузка
+   текстур) и позднюю (чтение курсора, последний проход, glfwSwapBuffers).
+   pace_wait спит между ними так, чтобы поздняя часть закончилась перед
+   ближайшим обновлением экрана; длительность поздней части предсказывается
+   по последним кадрам. Ввод, прочитанный после pace_wait, попадает на
+   экран с наименьшей задержкой.
+
+   Период и фаза обновлений экрана подгоняются по возвратам из
+   glfwSwapBuffers с вертикальной синхронизацией, частота режима
+   монитора - только начальное приближение. Каждые несколько секунд
+   пейсинг на пару кадров включает синхронизацию и уточняет сетку.
+   При частых промахах мимо срока или если сетка ушла пейсинг на время
+   возвращается к обычной синхронизации (glfwSwapInterval(1)). */
+
+// Нужен текущий GL-контекст; refresh - частота режима монитора, Гц
+void pace_init(double refresh);
+
+// Между ранней и поздней частью кадра; пока спит, обрабатывает события GLFW
+void pace_wait(void);
+// Сразу после glfwSwapBuffers (и latency_frame_end)
+void pace_frame_end(void);
+
+// 1, если сейчас работает обычная вертикальная синхронизация
+int pace_vsync(void);
+
+#endif
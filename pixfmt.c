@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pixfmt.h"
+
+PixFormat pixFormat = { GL_RGBA8, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, 0 };
+
+void pix_init_format(void) {
+  GLint internal = GL_RGBA8, format = GL_BGRA, type = GL_UNSIGNED_INT_8_8_8_8_REV;
+
+  pixFormat.internalFormat = GL_RGBA8;
+  pixFormat.format = GL_BGRA;
+  pixFormat.type = GL_UNSIGNED_INT_8_8_8_8_REV;
+  pixFormat.swizzle = 0;
+
+  // Без ARB_internalformat_query2 BGRA/8_8_8_8_REV - самый надёжный быстрый путь
+  if (!GLEW_VERSION_4_3 && !GLEW_ARB_internalformat_query2) return;
+
+  glGetInternalformativ(GL_TEXTURE_2D, GL_RGBA8, GL_INTERNALFORMAT_PREFERRED, 1, &internal);
+  if (internal == GL_RGBA8 || internal == GL_SRGB8_ALPHA8) {
+    pixFormat.internalFormat = internal;
+  }
+  glGetInternalformativ(GL_TEXTURE_2D, pixFormat.internalFormat, GL_TEXTURE_IMAGE_FORMAT, 1, &format);
+  glGetInternalformativ(GL_TEXTURE_2D, pixFormat.internalFormat, GL_TEXTURE_IMAGE_TYPE, 1, &type);
+
+  if (format == GL_RGBA && (type == GL_UNSIGNED_BYTE || type == GL_UNSIGNED_INT_8_8_8_8_REV)) {
+    // Загружаем байты как есть, а R и B переставляет сэмплер
+    pixFormat.format = GL_RGBA;
+    pixFormat.type = GL_UNSIGNED_BYTE;
+    pixFormat.swizzle = 1;
+  }
+}
+
+int pix_stride(int width) {
+  return (width * PIX_BPP + PIX_ROW_ALIGN - 1) & ~(PIX_ROW_ALIGN - 1);
+}
+
+void *pix_alloc(int width, int height, int *stride) {
+  *stride = pix_stride(width);
+  return aligned_alloc(PIX_ROW_ALIGN, (size_t)*stride * height);
+}
+
+void pix_free(void *pixels) {
+  free(pixels);
+}
+
+void pix_rgb_to_bgra(const unsigned char *src, int srcStride,
+    unsigned char *dst, int dstStride, int width, int height) {
+  for (int y = 0; y < height; y++) {
+    const unsigned char *s = src + (size_t)y * srcStride;
+    unsigned int *d = (unsigned int *)(dst + (size_t)y * dstStride);
+    for (int x = 0; x < width; x++, s += 3) {
+      d[x] = 0xFF000000u | s[0] << 16 | s[1] << 8 | s[2];
+    }
+  }
+}
+
+void pix_convert(const unsigned char *src, int srcStride, int channels,
+    unsigned char *dst, int dstStride, int width, int height) {
+  if (channels == 3) {
+    pix_rgb_to_bgra(src, srcStride, dst, dstStride, width, height);
+    return;
+  }
+  for (int y = 0; y < height; y++) {
+    const unsigned char *s = src + (size_t)y * srcStride;
+    unsigned int *d = (unsigned int *)(dst + (size_t)y * dstStride);
+    switch (channels) {
+    case 1: // Оттенки серого
+      for (int x = 0; x < width; x++) {
+        d[x] = 0xFF000000u | s[x] * 0x010101u;
+      }
+      break;
+    case 2: // Серый с альфой
+      for (int x = 0; x < width; x++, s += 2) {
+        d[x] = (unsigned int)s[1] << 24 | s[0] * 0x010101u;
+      }
+      break;
+    default: // RGBA
+      for (int x = 0; x < width; x++, s += 4) {
+        d[x] = (unsigned int)s[3] << 24 | s[0] << 16 | s[1] << 8 | s[2];
+      }
+    }
+  }
+}
+
+void pix_move(unsigned char *pixels, int stride, int x, int y, int w, int h, int sx, int sy) {
+  unsigned char *dst = pixels + (size_t)y * stride + x * PIX_BPP;
+  const unsigned char *src = pixels + (size_t)sy * stride + sx * PIX_BPP;
+  size_t bytes = (size_t)w * PIX_BPP;
+
+  // memmove сам выбирает направление внутри строки; строки - снизу вверх, если сдвиг вниз
+  if (y > sy) {
+    for (int i = h - 1; i >= 0; i--) memmove(dst + (size_t)i * stride, src + (size_t)i * stride, bytes);
+  } else if (y < sy || x != sx) {
+    for (int i = 0; i < h; i++) memmove(dst + (size_t)i * stride, src + (size_t)i * stride, bytes);
+  }
+}
+
+GLuint pix_create_texture(int width, int height, const void *pixels, int stride) {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  if (pixFormat.swizzle) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+  }
+  glTexImage2D(GL_TEXTURE_2D, 0, pixFormat.internalFormat, width, height, 0,
+      pixFormat.format, pixFormat.type, NULL);
+  if (pixels) pix_upload(texture, 0, 0, width, height, pixels, stride);
+  return texture;
+}
+
+void pix_upload(GLuint texture, int x, int y, int w, int h,
+    const void *pixels, int stride) {
+  const unsigned char *p = (const unsigned char *)pixels + (size_t)y * stride + x * PIX_BPP;
+
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, stride % 8 == 0 ? 8 : 4);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, stride / PIX_BPP);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, pixFormat.format, pixFormat.type, p);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
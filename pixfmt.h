@@ -0,0 +1,46 @@
+#ifndef PIXFMT_H
+#define PIXFMT_H
+
+#include <GL/glew.h>
+
+/* Канонический формат кадрового буфера: 32 бита на пиксель,
+   байты в памяти идут как B, G, R, A (0xAARRGGBB в little endian),
+   строки выровнены на PIX_ROW_ALIGN байт. В таком виде буфер
+   загружается в текстуру прямым копированием, без перепаковки. */
+
+#define PIX_BPP 4
+#define PIX_ROW_ALIGN 64
+
+typedef struct PixFormat {
+  GLenum internalFormat;
+  GLenum format;
+  GLenum type;
+  int swizzle; // Драйвер хочет RGBA: R и B меняются местами при выборке
+} PixFormat;
+
+extern PixFormat pixFormat;
+
+// Выбор формата загрузки по GL_INTERNALFORMAT_PREFERRED (нужен контекст)
+void pix_init_format(void);
+
+int pix_stride(int width);
+void *pix_alloc(int width, int height, int *stride);
+void pix_free(void *pixels);
+
+// Преобразование 1-4 канального изображения (stb_image) в BGRA
+void pix_convert(const unsigned char *src, int srcStride, int channels,
+    unsigned char *dst, int dstStride, int width, int height);
+void pix_rgb_to_bgra(const unsigned char *src, int srcStride,
+    unsigned char *dst, int dstStride, int width, int height);
+
+/* Перенос прямоугольника w x h из (sx, sy) в (x, y) внутри одного
+   буфера; области могут перекрываться (прокрутка) */
+void pix_move(unsigned char *pixels, int stride, int x, int y, int w, int h, int sx, int sy);
+
+// Создаёт текстуру и оставляет её привязанной к GL_TEXTURE_2D
+GLuint pix_create_texture(int width, int height, const void *pixels, int stride);
+// Загрузка прямоугольника (x, y, w, h) буфера с шагом stride в текстуру
+void pix_upload(GLuint texture, int x, int y, int w, int h,
+    const void *pixels, int stride);
+
+#endif
@@ -0,0 +1,207 @@
+#include <stdio.h>
+
+#include "postfx.h"
+
+typedef struct PostPass {
+  GLuint program;
+  GLint flipLocation;
+  int ownProgram; // Программа создана здесь (копирование) и удаляется вместе с проходом
+  float scale;
+  GLenum filter;
+  GLuint fbo, texture;
+  int width, height;
+} PostPass;
+
+static const char *vertexSource = "#version 330 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 1) in vec2 aTexCoord;\n"
+    "uniform bool flipY;\n"
+    "out vec2 TexCoord;\n"
+    "void main() {\n"
+    "  gl_Position = vec4(aPos, 0.0, 1.0);\n"
+    "  TexCoord = flipY ? vec2(aTexCoord.x, 1.0 - aTexCoord.y) : aTexCoord;\n"
+    "}\n";
+
+static const char *copySource = "#version 330 core\n"
+    "in vec2 TexCoord;\n"
+    "uniform sampler2D source;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "  FragColor = texture(source, TexCoord);\n"
+    "}\n";
+
+static PostPass passes[POST_MAX_PASSES];
+static int passCount;
+static int logicalW, logicalH;
+static GLuint vao, vbo;
+static GLuint sceneFbo, sceneTexture;
+static GLint viewport[4]; // Область вывода экрана, сохранённая post_begin
+static int began;
+
+static GLuint compile(GLenum type, const char *source) {
+  GLuint shader = glCreateShader(type);
+  GLint success;
+
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  if (!success) {
+    char infoLog[512];
+    glGetShaderInfoLog(shader, 512, NULL, infoLog);
+    fprintf(stderr, "Ошибка компиляции шейдера постобработки: %s\n", infoLog);
+  }
+  return shader;
+}
+
+GLuint post_program(const char *fragmentSource) {
+  GLuint vs = compile(GL_VERTEX_SHADER, vertexSource);
+  GLuint fs = compile(GL_FRAGMENT_SHADER, fragmentSource ? fragmentSource : copySource);
+  GLuint program = glCreateProgram();
+  GLint success;
+
+  glAttachShader(program, vs);
+  glAttachShader(program, fs);
+  glLinkProgram(program);
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success) {
+    char infoLog[512];
+    glGetProgramInfoLog(program, 512, NULL, infoLog);
+    fprintf(stderr, "Ошибка линковки шейдера постобработки: %s\n", infoLog);
+  }
+  glDeleteShader(vs);
+  glDeleteShader(fs);
+  return program;
+}
+
+// Текстура-цель и FBO для неё
+static void create_target(GLuint *fbo, GLuint *texture, int width, int height, GLenum filter) {
+  glGenTextures(1, texture);
+  glBindTexture(GL_TEXTURE_2D, *texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+
+  glGenFramebuffers(1, fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, *fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *texture, 0);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    printf("Post-processing target %dx%d is incomplete\n", width, height);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static void delete_target(GLuint *fbo, GLuint *texture) {
+  if (*fbo) glDeleteFramebuffers(1, fbo);
+  if (*texture) glDeleteTextures(1, texture);
+  *fbo = *texture = 0;
+}
+
+static void create_pass_target(PostPass *p) {
+  if (p->scale <= 0) return; // Проход на экран
+  p->width = (int)(logicalW * p->scale + 0.5f);
+  p->height = (int)(logicalH * p->scale + 0.5f);
+  if (p->width < 1) p->width = 1;
+  if (p->height < 1) p->height = 1;
+  create_target(&p->fbo, &p->texture, p->width, p->height, p->filter);
+}
+
+void post_init(int width, int height) {
+  // Как и в main.c: верх прямоугольника соответствует v = 0 (первой строке изображения)
+  static const float vertices[] = {
+    -1,  1,  0, 0,
+     1,  1,  1, 0,
+    -1, -1,  0, 1,
+     1, -1,  1, 1
+  };
+
+  logicalW = width;
+  logicalH = height;
+  passCount = 0;
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &vbo);
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+  glBindVertexArray(0);
+  create_target(&sceneFbo, &sceneTexture, width, height, GL_LINEAR);
+}
+
+void post_shutdown(void) {
+  for (int i = 0; i < passCount; i++) {
+    delete_target(&passes[i].fbo, &passes[i].texture);
+    if (passes[i].ownProgram) glDeleteProgram(passes[i].program);
+  }
+  passCount = 0;
+  delete_target(&sceneFbo, &sceneTexture);
+  glDeleteBuffers(1, &vbo);
+  glDeleteVertexArrays(1, &vao);
+}
+
+void post_resize(int width, int height) {
+  if (width == logicalW && height == logicalH) return;
+  logicalW = width;
+  logicalH = height;
+  delete_target(&sceneFbo, &sceneTexture);
+  create_target(&sceneFbo, &sceneTexture, width, height, GL_LINEAR);
+  for (int i = 0; i < passCount; i++) {
+    delete_target(&passes[i].fbo, &passes[i].texture);
+    create_pass_target(&passes[i]);
+  }
+}
+
+void post_add_pass(GLuint program, float scale, GLenum filter) {
+  PostPass *p = &passes[passCount];
+
+  if (passCount == POST_MAX_PASSES) return;
+  p->ownProgram = !program;
+  p->program = program ? program : post_program(NULL);
+  p->flipLocation = glGetUniformLocation(p->program, "flipY");
+  p->scale = scale;
+  p->filter = filter;
+  p->fbo = p->texture = 0;
+  create_pass_target(p);
+  passCount++;
+}
+
+void post_begin(void) {
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  began = 1;
+  glBindFramebuffer(GL_FRAMEBUFFER, sceneFbo);
+  glViewport(0, 0, logicalW, logicalH);
+}
+
+GLuint post_run(GLuint source) {
+  GLuint src = source ? source : sceneTexture;
+  int flip = !source; // Кадр из post_begin лежит в FBO снизу вверх
+
+  if (!began) glGetIntegerv(GL_VIEWPORT, viewport);
+  began = 0;
+  glBindVertexArray(vao);
+  glActiveTexture(GL_TEXTURE0);
+  for (int i = 0; i < passCount; i++) {
+    PostPass *p = &passes[i];
+    if (p->scale > 0) {
+      glBindFramebuffer(GL_FRAMEBUFFER, p->fbo);
+      glViewport(0, 0, p->width, p->height);
+    } else {
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+    glUseProgram(p->program);
+    glUniform1i(p->flipLocation, flip);
+    glBindTexture(GL_TEXTURE_2D, src);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    src = p->texture;
+    flip = 1;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  glBindVertexArray(0);
+  return passCount > 0 ? passes[passCount - 1].texture : src;
+}
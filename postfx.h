@@ -0,0 +1,40 @@
+#ifndef POSTFX_H
+#define POSTFX_H
+
+#include <GL/glew.h>
+
+/* Цепочка проходов постобработки. Каждый проход рисует полноэкранный
+   прямоугольник своим шейдером в собственную текстуру (FBO) размером
+   scale x логическое разрешение, читая результат предыдущего прохода
+   с блока текстуры 0. Эффекты так считаются на маленьком логическом
+   кадре (например, 320x200), а не на экране, который больше в 10-40 раз.
+   Последний проход с scale == 0 рисует прямо на экран, в текущую
+   область вывода (glViewport), и растягивает кадр.
+
+   Шейдер прохода получает in vec2 TexCoord, источник - первый sampler2D
+   (блок 0). Свои uniform проходов (время и т. п.) задаются заранее через
+   glUseProgram/glUniform. Текстуры FBO хранятся снизу вверх, как принято
+   в GL, а изображения - сверху вниз; TexCoord уже учитывает разницу. */
+
+#define POST_MAX_PASSES 8
+
+// Нужен текущий GL-контекст; width x height - логическое разрешение
+void post_init(int width, int height);
+void post_shutdown(void);
+// Смена логического разрешения (текстуры проходов пересоздаются)
+void post_resize(int width, int height);
+
+// Программа из фрагментного шейдера со встроенным вершинным; NULL - простое копирование
+GLuint post_program(const char *fragmentSource);
+// filter - фильтрация при чтении результата этого прохода следующим
+void post_add_pass(GLuint program, float scale, GLenum filter);
+
+// Привязывает логический кадр (FBO) для рисования сцены, источник для post_run(0)
+void post_begin(void);
+/* Выполняет проходы над source (текстура-изображение) или, если
+   source == 0, над кадром из post_begin. Возвращает текстуру последнего
+   внеэкранного прохода или 0, если последний проход рисовал на экран.
+   После вызова привязан экран и восстановлена область вывода. */
+GLuint post_run(GLuint source);
+
+#endif
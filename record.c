@@ -0,0 +1,98 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pixfmt.h"
+#include "record.h"
+
+#define FLUSH_SIZE (1 << 20) // Запись в файл порциями не меньше этой
+
+static void stamp(Recorder *r) {
+  uint64_t t = (uint64_t)((glfwGetTime() - r->start) * 1e6);
+
+  if (t != r->lastTime) {
+    remote_put_time(r->out, t);
+    r->lastTime = t;
+  }
+}
+
+Recorder *record_start(Display *d, const char *path) {
+  DisplayRect all = { 0, 0, d->width, d->height };
+  Recorder *r;
+  int fd;
+
+  if (d->recorder) return d->recorder;
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    perror(path);
+    return NULL;
+  }
+  r = calloc(1, sizeof(Recorder));
+  if (r) {
+    r->stride = d->width * 4;
+    r->shadow = calloc((size_t)r->stride, d->height);
+  }
+  if (!r || !r->shadow) {
+    free(r);
+    close(fd);
+    return NULL;
+  }
+  r->out = remote_open(fd, d->width, d->height); // Дальше fd принадлежит потоку
+  if (!r->out) {
+    free(r->shadow);
+    free(r);
+    return NULL;
+  }
+  r->start = glfwGetTime();
+  remote_put_time(r->out, 0);
+  remote_rect_delta(r->out, d->pixels, d->stride, r->shadow, r->stride, all);
+  d->recorder = r;
+  return r;
+}
+
+void record_stop(Display *d) {
+  Recorder *r = d->recorder;
+
+  if (!r) return;
+  stamp(r);
+  remote_send(r->out);
+  fprintf(stderr, "Записано кадров: %llu, событий: %llu, %.1f КБ\n",
+      (unsigned long long)r->frames, (unsigned long long)r->events, r->out->bytesSent / 1024.0);
+  remote_close(r->out);
+  free(r->shadow);
+  free(r);
+  d->recorder = NULL;
+}
+
+void record_event(Recorder *r, const DisplayEvent *event) {
+  stamp(r);
+  remote_put_event(r->out, event);
+  r->events++;
+}
+
+void record_frame(Recorder *r, const unsigned char *pixels, int stride, const DisplayRect *rects, int count) {
+  DisplayRect all = { 0, 0, r->out->width, r->out->height };
+
+  // После прокрутки без отметки: отметка закрыла бы кадр с одной копией
+  if (!r->scrolled) stamp(r);
+  r->scrolled = 0;
+  if (count <= 0) {
+    rects = &all;
+    count = 1;
+  }
+  for (int i = 0; i < count; i++) {
+    remote_rect_delta(r->out, pixels, stride, r->shadow, r->stride, rects[i]);
+  }
+  r->frames++;
+  if (r->out->outLen >= FLUSH_SIZE) remote_send(r->out);
+}
+
+void record_scroll(Recorder *r, DisplayRect dst, int srcX, int srcY) {
+  // Копия открывает кадр, в который попадёт и следующий Flush
+  stamp(r);
+  remote_copy(r->out, dst, srcX, srcY);
+  r->scrolled = 1;
+  pix_move(r->shadow, r->stride, dst.x, dst.y, dst.w, dst.h, srcX, srcY);
+}
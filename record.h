@@ -0,0 +1,39 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdint.h>
+
+#include "display.h"
+#include "remote.h"
+
+/* Запись сеанса дисплея для воспроизведения как нагрузки в тестах
+   производительности (bench/replay). В файл идёт поток remote.h:
+   события ввода прямо из обработчиков GLFW и изменённые прямоугольники
+   каждого Flush - разностью (XOR) с уже записанным кадром, сжатой
+   кодеками плиток, - с отметками времени в микросекундах от начала.
+
+   Запись включается вызовом record_start или переменной окружения
+   OBDISPLAY_RECORD=файл при OpenDisplay, так что сеанс можно записать
+   и без изменения программы. */
+
+typedef struct Recorder {
+  RemoteConn *out;
+  unsigned char *shadow; // Кадр, каким он уже записан
+  int stride;
+  double start;
+  uint64_t lastTime;
+  int scrolled; // Прокрутка ждёт следующего Flush в том же кадре потока
+  uint64_t frames, events;
+} Recorder;
+
+// Начинает запись кадра и событий d; первым пишется весь текущий кадр
+Recorder *record_start(Display *d, const char *path);
+void record_stop(Display *d);
+
+// Вызываются из display.c
+void record_event(Recorder *r, const DisplayEvent *event);
+void record_frame(Recorder *r, const unsigned char *pixels, int stride, const DisplayRect *rects, int count);
+// Прокрутка ScrollRect: dst из (srcX, srcY)
+void record_scroll(Recorder *r, DisplayRect dst, int srcX, int srcY);
+
+#endif
@@ -0,0 +1,789 @@
+#define _GNU_SOURCE // accept4
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "remote.h"
+
+#define HELLO_SIZE 10 // magic, version, width, height
+#define EVENT_SIZE 25 // Тип сообщения и шесть полей DisplayEvent
+#define TIME_SIZE 9 // Тип сообщения и время в микросекундах
+#define UPDATE_SIZE 13 // Заголовок изменения: способ, x, y, w, h, длина данных
+#define LZ_HASH 12 // log2 размера таблицы поиска повторов
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// --- Сокеты ---
+
+static int open_socket(const char *addr, int server) {
+  struct sockaddr_un un = { 0 };
+  struct addrinfo hints = { 0 }, *list, *ai;
+  char host[256];
+  const char *port;
+  int fd = -1, one = 1;
+
+  if (strncmp(addr, "unix:", 5) == 0) {
+    addr += 5;
+    if (strlen(addr) >= sizeof(un.sun_path)) return -1;
+    un.sun_family = AF_UNIX;
+    strcpy(un.sun_path, addr);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (server) unlink(addr);
+    if (server ? bind(fd, (struct sockaddr *)&un, sizeof(un)) || listen(fd, 1)
+        : connect(fd, (struct sockaddr *)&un, sizeof(un))) {
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  port = strrchr(addr, ':');
+  if (!port || port - addr >= (int)sizeof(host)) return -1;
+  memcpy(host, addr, port - addr);
+  host[port - addr] = '\0';
+  port++;
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = server ? AI_PASSIVE : 0;
+  if (getaddrinfo(host[0] ? host : NULL, port, &hints, &list)) return -1;
+  for (ai = list; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+    if (fd < 0) continue;
+    if (server) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (server ? !bind(fd, ai->ai_addr, ai->ai_addrlen) && !listen(fd, 1)
+        : !connect(fd, ai->ai_addr, ai->ai_addrlen)) break;
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(list);
+  return fd;
+}
+
+static RemoteConn *new_conn(int fd, int width, int height) {
+  RemoteConn *c = calloc(1, sizeof(RemoteConn));
+  int one = 1;
+
+  if (!c) {
+    close(fd);
+    return NULL;
+  }
+  // Кадры уходят целиком одним send, ждать сборки пакетов незачем
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  c->fd = fd;
+  c->width = width;
+  c->height = height;
+  return c;
+}
+
+static int write_all(int fd, const unsigned char *p, size_t n) {
+  ssize_t k;
+
+  while (n > 0) {
+    k = send(fd, p, n, MSG_NOSIGNAL);
+    if (k < 0 && errno == ENOTSOCK) k = write(fd, p, n); // Запись сеанса в файл
+    if (k <= 0) return 0;
+    p += k;
+    n -= k;
+  }
+  return 1;
+}
+
+// Принятые байты через буфер c->in; 0 при разрыве или конце файла
+static int read_all(RemoteConn *c, unsigned char *p, size_t n) {
+  size_t k;
+  ssize_t r;
+
+  while (n > 0) {
+    if (c->inPos == c->inLen) {
+      r = read(c->fd, c->in, sizeof(c->in));
+      if (r <= 0) return 0;
+      c->inPos = 0;
+      c->inLen = r;
+    }
+    k = c->inLen - c->inPos < n ? c->inLen - c->inPos : n;
+    memcpy(p, c->in + c->inPos, k);
+    c->inPos += k;
+    p += k;
+    n -= k;
+  }
+  return 1;
+}
+
+static unsigned char *scratch(RemoteConn *c, size_t size) {
+  unsigned char *p;
+
+  if (size > c->scratchCap) {
+    p = realloc(c->scratch, size);
+    if (!p) return NULL;
+    c->scratch = p;
+    c->scratchCap = size;
+  }
+  return c->scratch;
+}
+
+static void put16(unsigned char *p, unsigned v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static void put32(unsigned char *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static unsigned get16(const unsigned char *p) {
+  return p[0] | p[1] << 8;
+}
+
+static uint32_t get32(const unsigned char *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+int remote_listen(const char *addr) {
+  return open_socket(addr, 1);
+}
+
+RemoteConn *remote_open(int fd, int width, int height) {
+  unsigned char hello[HELLO_SIZE];
+  RemoteConn *c;
+
+  if (fd < 0) return NULL;
+  c = new_conn(fd, width, height);
+  if (!c) return NULL;
+  if (width > 0) {
+    put32(hello, REMOTE_MAGIC);
+    put16(hello + 4, REMOTE_VERSION);
+    put16(hello + 6, width);
+    put16(hello + 8, height);
+    if (write_all(fd, hello, sizeof(hello))) return c;
+  } else if (read_all(c, hello, sizeof(hello)) && get32(hello) == REMOTE_MAGIC &&
+      get16(hello + 4) == REMOTE_VERSION) {
+    c->width = get16(hello + 6);
+    c->height = get16(hello + 8);
+    return c;
+  } else {
+    fprintf(stderr, "remote: неверное приветствие\n");
+  }
+  remote_close(c);
+  return NULL;
+}
+
+RemoteConn *remote_accept(int listenFd, int width, int height) {
+  return remote_open(accept4(listenFd, NULL, NULL, SOCK_CLOEXEC), width, height);
+}
+
+RemoteConn *remote_connect(const char *addr) {
+  return remote_open(open_socket(addr, 0), 0, 0);
+}
+
+RemoteConn *remote_buffer(void) {
+  return new_conn(-1, 0, 0);
+}
+
+void remote_close(RemoteConn *c) {
+  if (!c) return;
+  if (c->fd >= 0) close(c->fd);
+  free(c->out);
+  free(c->scratch);
+  free(c);
+}
+
+// --- LZ (формат блоков LZ4) ---
+
+// Длина сверх 15 в токене: байты 255 и остаток
+static unsigned char *put_length(unsigned char *p, size_t n) {
+  for (; n >= 255; n -= 255) *p++ = 255;
+  *p++ = n;
+  return p;
+}
+
+static unsigned char *lz_sequence(unsigned char *p, const unsigned char *lit, size_t litLen,
+    size_t offset, size_t matchLen) {
+  unsigned char *token = p++;
+
+  *token = (litLen < 15 ? litLen : 15) << 4;
+  if (litLen >= 15) p = put_length(p, litLen - 15);
+  memcpy(p, lit, litLen);
+  p += litLen;
+  if (matchLen == 0) return p; // Последняя последовательность - только литералы
+  put16(p, offset);
+  p += 2;
+  matchLen -= 4;
+  *token |= matchLen < 15 ? matchLen : 15;
+  if (matchLen >= 15) p = put_length(p, matchLen - 15);
+  return p;
+}
+
+// dst - не меньше n + n / 255 + 16 байт; возвращает длину сжатого
+static size_t lz_compress(const unsigned char *src, size_t n, unsigned char *dst) {
+  uint32_t table[1 << LZ_HASH] = { 0 }; // Позиция + 1
+  unsigned char *p = dst;
+  size_t i = 0, anchor = 0, m, len;
+  uint32_t seq, cand;
+
+  while (i + 4 <= n) {
+    memcpy(&seq, src + i, 4);
+    cand = table[(seq * 2654435761u) >> (32 - LZ_HASH)];
+    table[(seq * 2654435761u) >> (32 - LZ_HASH)] = i + 1;
+    if (cand && i - (cand - 1) <= 65535 && memcmp(src + cand - 1, src + i, 4) == 0) {
+      m = cand - 1;
+      for (len = 4; i + len < n && src[m + len] == src[i + len]; len++);
+      p = lz_sequence(p, src + anchor, i - anchor, i - m, len);
+      i += len;
+      anchor = i;
+    } else {
+      i++;
+    }
+  }
+  p = lz_sequence(p, src + anchor, n - anchor, 0, 0);
+  return p - dst;
+}
+
+static int get_length(const unsigned char **p, const unsigned char *end, size_t *n) {
+  unsigned b;
+
+  do {
+    if (*p >= end) return 0;
+    b = *(*p)++;
+    *n += b;
+  } while (b == 255);
+  return 1;
+}
+
+// 1, если распаковано ровно n байт
+static int lz_decompress(const unsigned char *p, size_t len, unsigned char *dst, size_t n) {
+  const unsigned char *end = p + len;
+  size_t out = 0, lit, match, offset;
+  unsigned token;
+
+  while (p < end) {
+    token = *p++;
+    lit = token >> 4;
+    if (lit == 15 && !get_length(&p, end, &lit)) return 0;
+    if (lit > (size_t)(end - p) || lit > n - out) return 0;
+    memcpy(dst + out, p, lit);
+    p += lit;
+    out += lit;
+    if (p == end) break;
+    if (end - p < 2) return 0;
+    offset = get16(p);
+    p += 2;
+    match = (token & 15);
+    if (match == 15 && !get_length(&p, end, &match)) return 0;
+    match += 4;
+    if (offset == 0 || offset > out || match > n - out) return 0;
+    for (; match > 0; match--, out++) dst[out] = dst[out - offset]; // Повтор может перекрываться
+  }
+  return out == n;
+}
+
+// --- Отправка ---
+
+static unsigned char *reserve(RemoteConn *c, size_t n) {
+  unsigned char *p;
+  size_t cap;
+
+  if (c->outLen + n > c->outCap) {
+    cap = c->outCap ? c->outCap : 65536;
+    while (cap < c->outLen + n) cap *= 2;
+    p = realloc(c->out, cap);
+    if (!p) return NULL;
+    c->out = p;
+    c->outCap = cap;
+  }
+  return c->out + c->outLen;
+}
+
+// Заголовок изменения; кадр начинается с первым изменением
+static unsigned char *begin_update(RemoteConn *c, int kind, DisplayRect r, size_t dataMax) {
+  unsigned char *p;
+
+  if (!c->frameOpen) {
+    p = reserve(c, 5);
+    if (!p) return NULL;
+    p[0] = REMOTE_MSG_FRAME;
+    c->countPos = c->outLen + 1;
+    c->outLen += 5;
+    c->frameOpen = 1;
+    c->updates = 0;
+  }
+  p = reserve(c, UPDATE_SIZE + dataMax);
+  if (!p) return NULL;
+  p[0] = kind;
+  put16(p + 1, r.x);
+  put16(p + 3, r.y);
+  put16(p + 5, r.w);
+  put16(p + 7, r.h);
+  return p;
+}
+
+static void end_update(RemoteConn *c, size_t dataLen) {
+  put32(c->out + c->outLen + 9, dataLen);
+  c->outLen += UPDATE_SIZE + dataLen;
+  c->updates++;
+}
+
+// Любое сообщение, кроме изменения, закрывает кадр
+static void end_frame(RemoteConn *c) {
+  if (!c->frameOpen) return;
+  put32(c->out + c->countPos, c->updates);
+  c->frameOpen = 0;
+}
+
+void remote_copy(RemoteConn *c, DisplayRect dst, int srcX, int srcY) {
+  unsigned char *p = begin_update(c, REMOTE_COPY, dst, 4);
+
+  if (!p) return;
+  put16(p + UPDATE_SIZE, srcX);
+  put16(p + UPDATE_SIZE + 2, srcY);
+  end_update(c, 4);
+}
+
+// pixels - левый верхний угол плитки r; delta - REMOTE_DELTA или 0
+static void encode_tile(RemoteConn *c, const unsigned char *pixels, int stride, DisplayRect r, int delta) {
+  uint32_t palette[16], color;
+  size_t raw = (size_t)r.w * r.h * 4, len;
+  unsigned char *p, *q, *tile;
+  int colors = 0, last = 0, index, run;
+
+  // Палитра, пока цветов не больше 16
+  for (int y = 0; y < r.h && colors <= 16; y++) {
+    const uint32_t *row = (const uint32_t *)(pixels + (size_t)y * stride);
+    for (int x = 0; x < r.w; x++) {
+      if (colors > 0 && row[x] == palette[last]) continue;
+      for (last = 0; last < colors && palette[last] != row[x]; last++);
+      if (last == colors) {
+        if (colors == 16) {
+          colors = 17;
+          break;
+        }
+        palette[colors++] = row[x];
+      }
+    }
+  }
+
+  if (colors == 1) {
+    p = begin_update(c, REMOTE_SOLID | delta, r, 4);
+    if (!p) return;
+    memcpy(p + UPDATE_SIZE, &palette[0], 4);
+    end_update(c, 4);
+    return;
+  }
+
+  if (colors <= 16) {
+    // Байт серии: индекс в старших 4 битах, длина - 1 в младших (15 - дальше длина как в LZ)
+    p = begin_update(c, REMOTE_PALETTE | delta, r, 1 + 64 + raw / 4 * 2);
+    if (!p) return;
+    q = p + UPDATE_SIZE;
+    *q++ = colors;
+    memcpy(q, palette, colors * 4);
+    q += colors * 4;
+    index = -1;
+    run = 0;
+    last = 0;
+    for (int y = 0; y < r.h; y++) {
+      const uint32_t *row = (const uint32_t *)(pixels + (size_t)y * stride);
+      for (int x = 0; x < r.w; x++) {
+        color = row[x];
+        if (color != palette[last]) {
+          for (last = 0; palette[last] != color; last++);
+        }
+        if (last == index) {
+          run++;
+          continue;
+        }
+        if (run > 0) {
+          *q++ = index << 4 | (run - 1 < 15 ? run - 1 : 15);
+          if (run - 1 >= 15) q = put_length(q, run - 1 - 15);
+        }
+        index = last;
+        run = 1;
+      }
+    }
+    *q++ = index << 4 | (run - 1 < 15 ? run - 1 : 15);
+    if (run - 1 >= 15) q = put_length(q, run - 1 - 15);
+    end_update(c, q - p - UPDATE_SIZE);
+    return;
+  }
+
+  // Строки плитки подряд, затем LZ; если не сжалось - как есть
+  tile = scratch(c, raw);
+  if (!tile) return;
+  for (int y = 0; y < r.h; y++) {
+    memcpy(tile + (size_t)y * r.w * 4, pixels + (size_t)y * stride, r.w * 4);
+  }
+  p = begin_update(c, REMOTE_LZ | delta, r, raw + raw / 255 + 16);
+  if (!p) return;
+  len = lz_compress(tile, raw, p + UPDATE_SIZE);
+  if (len >= raw) {
+    p[0] = REMOTE_RAW | delta;
+    memcpy(p + UPDATE_SIZE, tile, raw);
+    len = raw;
+  }
+  end_update(c, len);
+}
+
+/* Плитки прямоугольника; если prev не NULL - разность (XOR) с ним, и
+   prev обновляется до pixels */
+static void encode_rect(RemoteConn *c, const unsigned char *pixels, int stride,
+    unsigned char *prev, int prevStride, DisplayRect r) {
+  double start = now();
+  int x1 = r.x + r.w, y1 = r.y + r.h;
+
+  if (r.x < 0) r.x = 0;
+  if (r.y < 0) r.y = 0;
+  if (x1 > c->width) x1 = c->width;
+  if (y1 > c->height) y1 = c->height;
+  for (int y = r.y; y < y1; y += REMOTE_TILE) {
+    for (int x = r.x; x < x1; x += REMOTE_TILE) {
+      DisplayRect t = { x, y, x1 - x < REMOTE_TILE ? x1 - x : REMOTE_TILE,
+          y1 - y < REMOTE_TILE ? y1 - y : REMOTE_TILE };
+      const unsigned char *src = pixels + (size_t)y * stride + x * 4;
+      if (!prev) {
+        encode_tile(c, src, stride, t, 0);
+        continue;
+      }
+      // Неизменённые пиксели дают нули, и плитка сжимается лучше
+      for (int ty = 0; ty < t.h; ty++) {
+        const uint32_t *a = (const uint32_t *)(src + (size_t)ty * stride);
+        uint32_t *b = (uint32_t *)(prev + (size_t)(y + ty) * prevStride + x * 4);
+        uint32_t *d = (uint32_t *)(c->tile + (size_t)ty * t.w * 4);
+        for (int tx = 0; tx < t.w; tx++) {
+          d[tx] = a[tx] ^ b[tx];
+          b[tx] = a[tx];
+        }
+      }
+      encode_tile(c, c->tile, t.w * 4, t, REMOTE_DELTA);
+    }
+  }
+  c->encodeTime += now() - start;
+}
+
+void remote_rect(RemoteConn *c, const unsigned char *pixels, int stride, DisplayRect r) {
+  encode_rect(c, pixels, stride, NULL, 0, r);
+}
+
+void remote_rect_delta(RemoteConn *c, const unsigned char *pixels, int stride,
+    unsigned char *prev, int prevStride, DisplayRect r) {
+  encode_rect(c, pixels, stride, prev, prevStride, r);
+}
+
+int remote_send(RemoteConn *c) {
+  int ok;
+
+  end_frame(c);
+  if (c->outLen == 0) return 1;
+  ok = write_all(c->fd, c->out, c->outLen);
+  c->bytesSent += c->outLen;
+  c->outLen = 0;
+  return ok;
+}
+
+void remote_put_event(RemoteConn *c, const DisplayEvent *event) {
+  unsigned char *p;
+
+  end_frame(c);
+  p = reserve(c, EVENT_SIZE);
+  if (!p) return;
+  p[0] = REMOTE_MSG_EVENT;
+  put32(p + 1, event->type);
+  put32(p + 5, event->x);
+  put32(p + 9, event->y);
+  put32(p + 13, event->key);
+  put32(p + 17, event->action);
+  put32(p + 21, event->mods);
+  c->outLen += EVENT_SIZE;
+}
+
+void remote_put_time(RemoteConn *c, uint64_t usec) {
+  unsigned char *p;
+
+  end_frame(c);
+  p = reserve(c, TIME_SIZE);
+  if (!p) return;
+  p[0] = REMOTE_MSG_TIME;
+  put32(p + 1, usec);
+  put32(p + 5, usec >> 32);
+  c->outLen += TIME_SIZE;
+}
+
+static void get_event(const unsigned char *p, DisplayEvent *event) {
+  event->type = get32(p + 1);
+  event->x = get32(p + 5);
+  event->y = get32(p + 9);
+  event->key = get32(p + 13);
+  event->action = get32(p + 17);
+  event->mods = get32(p + 21);
+}
+
+int remote_event(RemoteConn *c, DisplayEvent *event) {
+  ssize_t r;
+
+  for (;;) {
+    if (c->inLen - c->inPos >= EVENT_SIZE) {
+      if (c->in[c->inPos] != REMOTE_MSG_EVENT) return -1;
+      get_event(c->in + c->inPos, event);
+      c->inPos += EVENT_SIZE;
+      return 1;
+    }
+    // Неполное сообщение - в начало буфера и дочитать
+    memmove(c->in, c->in + c->inPos, c->inLen - c->inPos);
+    c->inLen -= c->inPos;
+    c->inPos = 0;
+    r = recv(c->fd, c->in + c->inLen, sizeof(c->in) - c->inLen, MSG_DONTWAIT);
+    if (r == 0) return -1;
+    if (r < 0) return 0;
+    c->inLen += r;
+  }
+}
+
+unsigned char *remote_pack(RemoteConn *c, const unsigned char *pixels, int stride,
+    int width, int height, size_t *size) {
+  unsigned char *data;
+
+  c->width = width;
+  c->height = height;
+  c->outLen = 0;
+  c->frameOpen = 1; // Только изменения, без заголовка кадра
+  encode_rect(c, pixels, stride, NULL, 0, (DisplayRect){ 0, 0, width, height });
+  c->frameOpen = 0;
+  data = malloc(c->outLen ? c->outLen : 1);
+  if (data) memcpy(data, c->out, c->outLen);
+  *size = c->outLen;
+  c->outLen = 0;
+  return data;
+}
+
+// --- Приём ---
+
+static void copy_area(unsigned char *pixels, int stride, DisplayRect r, int sx, int sy) {
+  size_t bytes = (size_t)r.w * 4;
+
+  // Перекрывающиеся области: строки в таком порядке, чтобы не затереть источник
+  if (sy < r.y) {
+    for (int y = r.h - 1; y >= 0; y--) {
+      memmove(pixels + (size_t)(r.y + y) * stride + r.x * 4, pixels + (size_t)(sy + y) * stride + sx * 4, bytes);
+    }
+  } else {
+    for (int y = 0; y < r.h; y++) {
+      memmove(pixels + (size_t)(r.y + y) * stride + r.x * 4, pixels + (size_t)(sy + y) * stride + sx * 4, bytes);
+    }
+  }
+}
+
+static int decode_palette(const unsigned char *p, size_t len, unsigned char *pixels, int stride, DisplayRect r) {
+  const unsigned char *end = p + len;
+  uint32_t palette[16];
+  size_t total = (size_t)r.w * r.h, i = 0, run;
+  int colors, index, x = 0;
+  uint32_t *row = (uint32_t *)pixels;
+
+  if (len < 1) return 0;
+  colors = *p++;
+  if (colors < 1 || colors > 16 || (size_t)(end - p) < (size_t)colors * 4) return 0;
+  memcpy(palette, p, colors * 4);
+  p += colors * 4;
+  while (p < end) {
+    index = *p >> 4;
+    run = *p++ & 15;
+    if (run == 15 && !get_length(&p, end, &run)) return 0;
+    run++;
+    if (index >= colors || run > total - i) return 0;
+    i += run;
+    for (; run > 0; run--) {
+      row[x] = palette[index];
+      if (++x == r.w) {
+        x = 0;
+        row = (uint32_t *)((unsigned char *)row + stride);
+      }
+    }
+  }
+  return i == total;
+}
+
+// Плитка w x h в dst (левый верхний угол) из данных способа kind
+static int decode_tile(RemoteConn *c, int kind, unsigned char *data, size_t len,
+    unsigned char *dst, int stride, DisplayRect r) {
+  size_t raw = (size_t)r.w * r.h * 4;
+  uint32_t color;
+
+  switch (kind) {
+  case REMOTE_SOLID:
+    if (len != 4) return 0;
+    memcpy(&color, data, 4);
+    for (int y = 0; y < r.h; y++) {
+      uint32_t *row = (uint32_t *)(dst + (size_t)y * stride);
+      for (int x = 0; x < r.w; x++) row[x] = color;
+    }
+    return 1;
+  case REMOTE_PALETTE:
+    return decode_palette(data, len, dst, stride, r);
+  case REMOTE_RAW:
+    if (len != raw) return 0;
+    break;
+  case REMOTE_LZ:
+    // Плитка не больше 64x64: распаковка во вторую половину того же буфера
+    data = scratch(c, len + raw);
+    if (!data || !lz_decompress(data, len, data + len, raw)) return 0;
+    data += len;
+    break;
+  default:
+    return 0;
+  }
+  for (int y = 0; y < r.h; y++) {
+    memcpy(dst + (size_t)y * stride, data + (size_t)y * r.w * 4, r.w * 4);
+  }
+  return 1;
+}
+
+// 2 - копия, которую выполняет c->scroll (источник в src)
+static int decode_update(RemoteConn *c, const unsigned char *head, unsigned char *pixels, int stride,
+    DisplayRect *r, int *src) {
+  size_t len = get32(head + 9), raw;
+  unsigned char *data, *dst;
+  int sx, sy;
+
+  r->x = get16(head + 1);
+  r->y = get16(head + 3);
+  r->w = get16(head + 5);
+  r->h = get16(head + 7);
+  raw = (size_t)r->w * r->h * 4;
+  if (r->w == 0 || r->h == 0 || r->x + r->w > c->width || r->y + r->h > c->height ||
+      len > raw + raw / 255 + 16 + 65) return 0;
+  data = scratch(c, len > 0 ? len : 1);
+  if (!data || !read_all(c, data, len)) return 0;
+  dst = pixels + (size_t)r->y * stride + r->x * 4;
+
+  if (head[0] == REMOTE_COPY) {
+    if (len != 4) return 0;
+    sx = get16(data);
+    sy = get16(data + 2);
+    if (sx + r->w > c->width || sy + r->h > c->height) return 0;
+    src[0] = sx;
+    src[1] = sy;
+    if (c->scroll) return 2;
+    copy_area(pixels, stride, *r, sx, sy);
+    return 1;
+  }
+  if (!(head[0] & REMOTE_DELTA)) return decode_tile(c, head[0], data, len, dst, stride, *r);
+
+  if (r->w > REMOTE_TILE || r->h > REMOTE_TILE ||
+      !decode_tile(c, head[0] & ~REMOTE_DELTA, data, len, c->tile, r->w * 4, *r)) return 0;
+  for (int y = 0; y < r->h; y++) {
+    uint32_t *row = (uint32_t *)(dst + (size_t)y * stride);
+    const uint32_t *d = (const uint32_t *)(c->tile + (size_t)y * r->w * 4);
+    for (int x = 0; x < r->w; x++) row[x] ^= d[x];
+  }
+  return 1;
+}
+
+int remote_read(RemoteConn *c, RemoteMessage *m, unsigned char *pixels, int stride, DisplayRect *rects, int max) {
+  unsigned char head[UPDATE_SIZE];
+  uint32_t count;
+  DisplayRect r;
+  int n = 0, src[2] = { 0, 0 }, scrolled = 0, k;
+
+  if (!read_all(c, head, 1)) return -1;
+  m->type = head[0];
+  switch (head[0]) {
+  case REMOTE_MSG_EVENT:
+    if (!read_all(c, head + 1, EVENT_SIZE - 1)) return -1;
+    get_event(head, &m->event);
+    return m->type;
+  case REMOTE_MSG_TIME:
+    if (!read_all(c, head + 1, TIME_SIZE - 1)) return -1;
+    m->time = get32(head + 1) | (uint64_t)get32(head + 5) << 32;
+    return m->type;
+  case REMOTE_MSG_FRAME:
+    break;
+  default:
+    return -1;
+  }
+
+  if (!read_all(c, head + 1, 4)) return -1;
+  count = get32(head + 1);
+  for (uint32_t i = 0; i < count; i++) {
+    if (!read_all(c, head, UPDATE_SIZE) || !(k = decode_update(c, head, pixels, stride, &r, src))) return -1;
+    if (k == 2) {
+      // Принятое до копии - вызывающему до сдвига, дальше кадр собирается заново
+      c->scroll(c->scrollCtx, rects, n == 0 ? -1 : n > max ? 0 : n, r, src[0], src[1]);
+      scrolled = 1;
+      n = 0;
+      continue;
+    }
+    // Соседние плитки одной строки сливаются в один прямоугольник
+    if (n > 0 && n <= max && rects[n - 1].y == r.y && rects[n - 1].h == r.h &&
+        rects[n - 1].x + rects[n - 1].w == r.x) {
+      rects[n - 1].w += r.w;
+    } else {
+      if (n < max) rects[n] = r;
+      n++;
+    }
+  }
+  if (n == 0 && scrolled && max > 0) {
+    // Кадр из одних прокруток: выводить, но загружать нечего
+    rects[0] = (DisplayRect){ 0, 0, 0, 0 };
+    n = 1;
+  }
+  m->count = n > max ? 0 : n;
+  return m->type;
+}
+
+int remote_receive(RemoteConn *c, unsigned char *pixels, int stride, DisplayRect *rects, int max) {
+  RemoteMessage m;
+  int type;
+
+  while ((type = remote_read(c, &m, pixels, stride, rects, max)) != REMOTE_MSG_FRAME) {
+    if (type < 0) return -1;
+  }
+  return m.count;
+}
+
+int remote_unpack(RemoteConn *c, const unsigned char *data, size_t size,
+    unsigned char *pixels, int stride, int width, int height) {
+  const unsigned char *p = data, *end = data + size;
+  unsigned char *tile;
+  size_t len, area = 0;
+  DisplayRect r;
+
+  while (end - p >= UPDATE_SIZE) {
+    r = (DisplayRect){ get16(p + 1), get16(p + 3), get16(p + 5), get16(p + 7) };
+    len = get32(p + 9);
+    p += UPDATE_SIZE;
+    if (r.w == 0 || r.h == 0 || r.w > REMOTE_TILE || r.h > REMOTE_TILE ||
+        r.x + r.w > width || r.y + r.h > height || len > (size_t)(end - p)) return 0;
+    // decode_tile ждёт данные в scratch
+    tile = scratch(c, len > 0 ? len : 1);
+    if (!tile) return 0;
+    memcpy(tile, p, len);
+    if (!decode_tile(c, p[-UPDATE_SIZE], tile, len, pixels + (size_t)r.y * stride + r.x * 4, stride, r)) return 0;
+    p += len;
+    area += (size_t)r.w * r.h;
+  }
+  return p == end && area == (size_t)width * height;
+}
+
+int remote_pending(RemoteConn *c) {
+  return c->inPos < c->inLen;
+}
+
+int remote_send_event(RemoteConn *c, const DisplayEvent *event) {
+  remote_put_event(c, event);
+  return remote_send(c);
+}
@@ -0,0 +1,129 @@
+#ifndef REMOTE_H
+#define REMOTE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "display.h"
+
+/* Удалённый дисплей: кадр сеанса без окна (например, Oberon на
+   сервере) передаётся по сокету зрителю, который выводит его через
+   Display. По сети идут только изменённые прямоугольники, поэтому
+   трафик и время кодирования растут с объёмом изменений, а не с
+   размером экрана.
+
+   Прямоугольник режется на плитки 64x64, и каждая кодируется
+   отдельно самым дешёвым подходящим способом:
+     REMOTE_SOLID   - плитка одного цвета, 4 байта;
+     REMOTE_PALETTE - до 16 цветов: палитра и серии (RLE) индексов;
+     REMOTE_LZ      - остальное: LZ в формате блоков LZ4;
+     REMOTE_RAW     - если LZ не сжал.
+   REMOTE_COPY переносит уже переданную область (прокрутка) без пикселей.
+   С флагом REMOTE_DELTA плитка - разность (XOR) с тем, что уже есть у
+   получателя: неизменённые пиксели становятся нулями.
+
+   Тот же поток, записанный в файл вместе с событиями ввода и
+   отметками времени, - запись сеанса (record.h).
+
+   Адрес: "unix:/путь" - Unix-сокет, иначе "узел:порт" (TCP; узел
+   можно не указывать). Обратно зритель шлёт события ввода. Все числа в
+   протоколе little-endian. */
+
+#define REMOTE_MAGIC 0x4D52424F // "OBRM"
+#define REMOTE_VERSION 1
+#define REMOTE_TILE 64
+
+enum { REMOTE_SOLID = 1, REMOTE_PALETTE, REMOTE_LZ, REMOTE_RAW, REMOTE_COPY };
+#define REMOTE_DELTA 0x80
+
+// Сообщения потока
+enum { REMOTE_MSG_FRAME = 1, REMOTE_MSG_EVENT, REMOTE_MSG_TIME };
+
+typedef struct RemoteMessage {
+  int type;
+  int count; // REMOTE_MSG_FRAME: как у remote_receive
+  DisplayEvent event; // REMOTE_MSG_EVENT
+  uint64_t time; // REMOTE_MSG_TIME, микросекунды
+} RemoteMessage;
+
+/* Прокрутка на приёме вместо копии в pixels (RemoteConn.scroll): сдвиг
+   dst из (srcX, srcY), например через ScrollRect. rects, count -
+   прямоугольники кадра, принятые до копии (как у remote_receive, count
+   0 - весь кадр, -1 - нет): их надо вывести до сдвига. */
+typedef void RemoteScroll(void *ctx, const DisplayRect *rects, int count, DisplayRect dst, int srcX, int srcY);
+
+typedef struct RemoteConn {
+  int fd;
+  int width, height; // Размер кадра сеанса
+  unsigned char *out; // Кадр, собираемый к отправке
+  size_t outLen, outCap, countPos;
+  uint32_t updates;
+  int frameOpen;
+  unsigned char in[65536]; // Приём
+  size_t inPos, inLen;
+  unsigned char *scratch; // Плитка для кодирования или принятые данные
+  size_t scratchCap;
+  unsigned char tile[REMOTE_TILE * REMOTE_TILE * 4]; // Разность плитки
+  RemoteScroll *scroll; // NULL - копии применяются к pixels
+  void *scrollCtx;
+  // Статистика отправки
+  uint64_t bytesSent;
+  double encodeTime; // Секунды
+} RemoteConn;
+
+/* Поток поверх открытого дескриптора (сокета или файла). width > 0:
+   отправка, приветствие пишется; иначе приём, размер - из приветствия. */
+RemoteConn *remote_open(int fd, int width, int height);
+
+// Сеанс
+
+// Дескриптор слушающего сокета или -1
+int remote_listen(const char *addr);
+// Ждёт зрителя и сообщает ему размер кадра
+RemoteConn *remote_accept(int listenFd, int width, int height);
+/* Изменения к отправке, в порядке вызовов. Копия берёт пиксели из
+   кадра зрителя на момент её применения, поэтому прокрутку надо
+   сообщать раньше прямоугольников, нарисованных после неё. */
+void remote_copy(RemoteConn *c, DisplayRect dst, int srcX, int srcY);
+void remote_rect(RemoteConn *c, const unsigned char *pixels, int stride, DisplayRect r);
+/* Разность с prev - копией кадра, какой он у получателя; prev
+   обновляется. Выгодна, когда в прямоугольнике изменилось не всё. */
+void remote_rect_delta(RemoteConn *c, const unsigned char *pixels, int stride,
+    unsigned char *prev, int prevStride, DisplayRect r);
+// Событие и отметка времени в буфер отправки; закрывают текущий кадр
+void remote_put_event(RemoteConn *c, const DisplayEvent *event);
+void remote_put_time(RemoteConn *c, uint64_t usec);
+// Отправляет всё накопленное; 0, если зритель отключился
+int remote_send(RemoteConn *c);
+// Событие от зрителя, без ожидания: 1, если есть, -1 - зритель отключился
+int remote_event(RemoteConn *c, DisplayEvent *event);
+
+// Зритель
+
+RemoteConn *remote_connect(const char *addr);
+/* Принимает один кадр и декодирует его в pixels (размер кадра сеанса).
+   Возвращает число изменённых прямоугольников в rects; 0 - больше max,
+   обновить весь кадр; -1 - ошибка или разрыв. */
+int remote_receive(RemoteConn *c, unsigned char *pixels, int stride, DisplayRect *rects, int max);
+/* Любое следующее сообщение; кадр декодируется как в remote_receive.
+   С c->scroll копии уходят туда, и в rects остаются только
+   прямоугольники после последней копии; если их нет - один пустой.
+   Возвращает m->type или -1 - ошибка или конец потока. */
+int remote_read(RemoteConn *c, RemoteMessage *m, unsigned char *pixels, int stride, DisplayRect *rects, int max);
+// Есть ли принятые, но не разобранные данные
+int remote_pending(RemoteConn *c);
+int remote_send_event(RemoteConn *c, const DisplayEvent *event);
+
+/* Сжатие в память теми же плитками, без сообщений потока (хранилища
+   вьюеров, store.h). Соединению без дескриптора нужны только буферы. */
+RemoteConn *remote_buffer(void);
+// Сжатый кадр width x height в новом буфере malloc, *size - его длина
+unsigned char *remote_pack(RemoteConn *c, const unsigned char *pixels, int stride,
+    int width, int height, size_t *size);
+// 1, если data - весь кадр width x height
+int remote_unpack(RemoteConn *c, const unsigned char *data, size_t size,
+    unsigned char *pixels, int stride, int width, int height);
+
+void remote_close(RemoteConn *c);
+
+#endif
@@ -0,0 +1,101 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../remote.h"
+
+/* Сеанс без окна: рисует в кадр в памяти и передаёт изменения зрителю
+   (./viewer). Движется квадрат, а лента справа прокручивается на строку
+   за кадр - копией на стороне зрителя и одной новой строкой. Раз в
+   секунду печатает трафик и время кодирования. */
+
+#define WIDTH 1024
+#define HEIGHT 768
+#define STRIDE (WIDTH * 4)
+
+static unsigned char frame[STRIDE * HEIGHT];
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill(DisplayRect r, uint32_t color) {
+  for (int y = r.y; y < r.y + r.h; y++) {
+    uint32_t *row = (uint32_t *)(frame + (size_t)y * STRIDE);
+    for (int x = r.x; x < r.x + r.w; x++) row[x] = color;
+  }
+}
+
+static void scroll_up(DisplayRect r) {
+  memmove(frame + (size_t)r.y * STRIDE, frame + (size_t)(r.y + 1) * STRIDE, (size_t)(r.h - 1) * STRIDE);
+}
+
+int main(int argc, char **argv) {
+  const char *addr = argc > 1 ? argv[1] : "unix:/tmp/obremote";
+  DisplayRect all = { 0, 0, WIDTH, HEIGHT }, square = { 0, 0, 96, 96 }, old;
+  DisplayRect tape = { WIDTH - 256, 0, 256, HEIGHT }, line = { WIDTH - 256, HEIGHT - 1, 256, 1 };
+  struct timespec tick = { 0, 16000000 };
+  DisplayEvent ev;
+  RemoteConn *c;
+  double start, last;
+  uint32_t color = 0xFFE0A040;
+  uint64_t bytes = 0;
+  int listenFd, frames = 0, ok;
+
+  listenFd = remote_listen(addr);
+  if (listenFd < 0) {
+    fprintf(stderr, "Не удалось открыть %s\n", addr);
+    return 1;
+  }
+  fill(all, 0xFF203040);
+  for (;;) {
+    printf("Сеанс ждёт зрителя на %s\n", addr);
+    c = remote_accept(listenFd, WIDTH, HEIGHT);
+    if (!c) continue;
+    remote_rect(c, frame, STRIDE, all);
+    ok = remote_send(c);
+
+    start = last = now();
+    while (ok) {
+      while (remote_event(c, &ev) > 0) {
+        if (ev.type == EVENT_MOUSE_BUTTON && ev.action == 1) color ^= 0x00FFFFFF;
+      }
+
+      double t = now() - start;
+      old = square;
+      square.x = (int)((tape.x - square.w) * (0.5 + 0.5 * sin(t)));
+      square.y = (int)((HEIGHT - square.h) * (0.5 + 0.5 * cos(t * 0.7)));
+      fill(old, 0xFF203040);
+      fill(square, color);
+      remote_rect(c, frame, STRIDE, old);
+      remote_rect(c, frame, STRIDE, square);
+
+      // Прокрутка: копия у зрителя, затем только новая строка
+      scroll_up(tape);
+      for (int x = 0; x < line.w; x++) {
+        ((uint32_t *)(frame + (size_t)line.y * STRIDE))[line.x + x] =
+            (x / 8 + frames / 8) % 4 ? 0xFF101010 : 0xFF80FF80;
+      }
+      remote_copy(c, (DisplayRect){ tape.x, tape.y, tape.w, tape.h - 1 }, tape.x, tape.y + 1);
+      remote_rect(c, frame, STRIDE, line);
+      ok = remote_send(c);
+
+      frames++;
+      if (now() - last >= 1) {
+        printf("%d кадров/с, %.1f КБ/с, кодирование %.3f мс/кадр\n", frames,
+            (c->bytesSent - bytes) / 1024.0 / (now() - last), c->encodeTime * 1000 / frames);
+        bytes = c->bytesSent;
+        c->encodeTime = 0;
+        frames = 0;
+        last = now();
+      }
+      nanosleep(&tick, NULL);
+    }
+    remote_close(c);
+  }
+}
@@ -0,0 +1,51 @@
+#include <poll.h>
+#include <stdio.h>
+
+#include "../display.h"
+#include "../remote.h"
+
+/* Зритель удалённого сеанса: принимает изменения кадра прямо в кадр
+   Display и выводит только их; ввод из окна уходит обратно в сеанс. */
+
+int main(int argc, char **argv) {
+  const char *addr = argc > 1 ? argv[1] : "unix:/tmp/obremote";
+  RemoteConn *c;
+  Display *d;
+  DisplayEvent ev;
+  DisplayRect rects[64];
+  struct pollfd pfd;
+  int n, quit = 0;
+
+  c = remote_connect(addr);
+  if (!c) {
+    fprintf(stderr, "Нет сеанса на %s\n", addr);
+    return 1;
+  }
+  d = OpenDisplay(c->width, c->height, DISPLAY_WINDOWED);
+  if (!d) {
+    remote_close(c);
+    return 1;
+  }
+  pfd.fd = c->fd;
+  pfd.events = POLLIN;
+
+  while (!quit) {
+    // Сначала все пришедшие кадры, затем окно
+    while (remote_pending(c) || poll(&pfd, 1, 0) > 0) {
+      n = remote_receive(c, d->pixels, d->stride, rects, 64);
+      if (n < 0) {
+        quit = 1;
+        break;
+      }
+      Flush(d, rects, n);
+    }
+    if (NextEvent(d, &ev, 2)) {
+      if (ev.type == EVENT_CLOSE) quit = 1;
+      else remote_send_event(c, &ev);
+    }
+  }
+
+  Close(d);
+  remote_close(c);
+  return 0;
+}
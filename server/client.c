@@ -0,0 +1,76 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../shm.h"
+
+/* Клиент дисплей-сервера: рисует прямо в общий кадр движущийся
+   квадрат и сообщает серверу только изменённые прямоугольники.
+   Без GL; собственные пиксели никуда не копируются. */
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill(ShmClient *c, DisplayRect r, uint32_t color) {
+  for (int y = r.y; y < r.y + r.h; y++) {
+    uint32_t *row = (uint32_t *)(c->pixels + (size_t)y * c->stride);
+    for (int x = r.x; x < r.x + r.w; x++) row[x] = color;
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "/tmp/obdisplay";
+  ShmClient *c;
+  DisplayEvent ev;
+  DisplayRect all, rects[2], square = { 0, 0, 64, 64 }, old;
+  uint32_t color = 0xFF40C0FF;
+  double start, last;
+  int frames = 0, result;
+
+  c = shm_connect(path);
+  if (!c) {
+    fprintf(stderr, "Нет сервера на %s\n", path);
+    return 1;
+  }
+  printf("Кадр %dx%d, шаг строки %d\n", c->width, c->height, c->stride);
+
+  // Первый кадр целиком
+  all = (DisplayRect){ 0, 0, c->width, c->height };
+  fill(c, all, 0xFF202020);
+  shm_damage(c, NULL, 0);
+
+  start = last = now();
+  for (;;) {
+    // До SHM_DONE сервер читает кадр, писать в него нельзя
+    result = shm_wait(c, &ev, NULL, -1);
+    if (result < 0) break;
+    if (result == SHM_EVENT) {
+      if (ev.type == EVENT_MOUSE_BUTTON && ev.action == GLFW_PRESS) color ^= 0x00FFFFFF;
+      continue;
+    }
+
+    double t = now() - start;
+    old = square;
+    square.x = (int)((c->width - square.w) * (0.5 + 0.5 * sin(t)));
+    square.y = (int)((c->height - square.h) * (0.5 + 0.5 * cos(t * 0.7)));
+    fill(c, old, 0xFF202020);
+    fill(c, square, color);
+    rects[0] = old;
+    rects[1] = square;
+    if (!shm_damage(c, rects, 2)) break;
+
+    frames++;
+    if (now() - last >= 1) {
+      printf("%d кадров/с\n", frames);
+      frames = 0;
+      last = now();
+    }
+  }
+
+  shm_disconnect(c);
+  return 0;
+}
@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../display.h"
+#include "../shm.h"
+
+/* Дисплей-сервер: окно с кадром в общей памяти. Рисует в кадр клиент
+   из другого процесса (./client), сервер выводит изменённые им места и
+   пересылает ему ввод. Клиент может падать и подключаться заново. */
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "/tmp/obdisplay";
+  Display *d;
+  DisplayEvent ev;
+  int quit = 0;
+
+  d = OpenDisplay(1024, 768, DISPLAY_WINDOWED);
+  if (!d) return 1;
+  if (!shm_serve(d, path)) {
+    fprintf(stderr, "Не удалось открыть сокет %s\n", path);
+    Close(d);
+    return 1;
+  }
+  printf("Сервер ждёт клиента на %s\n", path);
+  Flush(d, NULL, 0);
+
+  while (!quit) {
+    // Поток сокета будит ожидание, когда клиент прислал изменения
+    if (NextEvent(d, &ev, -1)) {
+      if (ev.type == EVENT_CLOSE) quit = 1;
+      else if (ev.type == EVENT_KEY && ev.key == GLFW_KEY_ESCAPE) quit = 1;
+      else shm_forward(&ev);
+    }
+    shm_poll(d);
+  }
+
+  shm_stop();
+  Close(d);
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include <poll.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "shm.h"
+
+int shm_send(int sock, const void *msg, int size, int fd) {
+  struct iovec iov = { (void *)msg, size };
+  struct msghdr m = { 0 };
+  union { // Выравнивание буфера под cmsghdr
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  struct cmsghdr *cm;
+
+  m.msg_iov = &iov;
+  m.msg_iovlen = 1;
+  if (fd >= 0) {
+    memset(&control, 0, sizeof(control));
+    m.msg_control = control.buf;
+    m.msg_controllen = sizeof(control.buf);
+    cm = CMSG_FIRSTHDR(&m);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+  }
+  // Клиент мог уже отключиться: без SIGPIPE и без ожидания места в сокете
+  return sendmsg(sock, &m, MSG_NOSIGNAL | MSG_DONTWAIT) == size;
+}
+
+// Приветствие сервера и дескриптор memfd; -1 при ошибке
+static int recv_hello(int sock, ShmHello *hello) {
+  struct iovec iov = { hello, sizeof(ShmHello) };
+  struct msghdr m = { 0 };
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  struct cmsghdr *cm;
+  int fd = -1;
+
+  m.msg_iov = &iov;
+  m.msg_iovlen = 1;
+  m.msg_control = control.buf;
+  m.msg_controllen = sizeof(control.buf);
+  if (recvmsg(sock, &m, MSG_CMSG_CLOEXEC) != sizeof(ShmHello)) return -1;
+  for (cm = CMSG_FIRSTHDR(&m); cm; cm = CMSG_NXTHDR(&m, cm)) {
+    if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS) {
+      memcpy(&fd, CMSG_DATA(cm), sizeof(int));
+    }
+  }
+  return fd;
+}
+
+ShmClient *shm_connect(const char *path) {
+  struct sockaddr_un addr = { 0 };
+  ShmHello hello;
+  ShmClient *c;
+  void *p;
+  int sock, fd;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) return NULL;
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (sock < 0) return NULL;
+  if (connect(sock, (struct sockaddr *)&addr, sizeof(addr))) {
+    close(sock);
+    return NULL;
+  }
+
+  fd = recv_hello(sock, &hello);
+  if (fd < 0 || hello.type != SHM_HELLO || hello.magic != SHM_MAGIC ||
+      hello.version != SHM_VERSION || hello.format != SHM_FORMAT_BGRA) {
+    fprintf(stderr, "shm: неверное приветствие сервера\n");
+    if (fd >= 0) close(fd);
+    close(sock);
+    return NULL;
+  }
+  p = mmap(NULL, (size_t)hello.stride * hello.height, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd); // Отображение держит memfd само
+  c = p != MAP_FAILED ? calloc(1, sizeof(ShmClient)) : NULL;
+  if (!c) {
+    if (p != MAP_FAILED) munmap(p, (size_t)hello.stride * hello.height);
+    close(sock);
+    return NULL;
+  }
+  c->sock = sock;
+  c->pixels = p;
+  c->width = hello.width;
+  c->height = hello.height;
+  c->stride = hello.stride;
+  return c;
+}
+
+void shm_disconnect(ShmClient *c) {
+  if (!c) return;
+  munmap(c->pixels, (size_t)c->stride * c->height);
+  close(c->sock);
+  free(c);
+}
+
+int shm_damage(ShmClient *c, const DisplayRect *rects, int count) {
+  ShmDamage msg;
+
+  msg.type = SHM_DAMAGE;
+  msg.serial = ++c->serial;
+  msg.count = count > SHM_MAX_RECTS ? 0 : count;
+  if (msg.count > 0) memcpy(msg.rects, rects, msg.count * sizeof(DisplayRect));
+  // Отправляется только заполненная часть
+  return shm_send(c->sock, &msg, offsetof(ShmDamage, rects) + msg.count * sizeof(DisplayRect), -1);
+}
+
+int shm_wait(ShmClient *c, DisplayEvent *event, int32_t *serial, int timeoutMs) {
+  union {
+    int32_t type;
+    ShmDone done;
+    ShmEvent event;
+  } msg;
+  struct pollfd pfd = { c->sock, POLLIN, 0 };
+  ssize_t n;
+
+  for (;;) {
+    if (poll(&pfd, 1, timeoutMs < 0 ? -1 : timeoutMs) <= 0) return 0;
+    n = recv(c->sock, &msg, sizeof(msg), 0);
+    if (n <= 0) return -1;
+    if (msg.type == SHM_DONE && n == sizeof(ShmDone)) {
+      if (serial) *serial = msg.done.serial;
+      return SHM_DONE;
+    }
+    if (msg.type == SHM_EVENT && n == sizeof(ShmEvent)) {
+      if (event) *event = msg.event.event;
+      return SHM_EVENT;
+    }
+    // Неизвестные сообщения пропускаются
+  }
+}
@@ -0,0 +1,88 @@
+#ifndef SHM_H
+#define SHM_H
+
+#include <stdint.h>
+
+#include "display.h"
+
+/* Дисплей-сервер для клиентов в другом процессе (например, система
+   Oberon отдельно от окна), по образцу MIT-SHM. Кадр Display лежит в
+   memfd; сервер передаёт дескриптор клиенту через Unix-сокет
+   (SCM_RIGHTS), и клиент рисует прямо в общую память. Затем клиент
+   шлёт сообщение с изменёнными прямоугольниками, сервер загружает в
+   текстуру только их (Flush) и отвечает SHM_DONE - после этого клиент
+   снова может писать в кадр. Сам кадр между процессами не копируется
+   никогда, по сокету идут только прямоугольники и события ввода.
+
+   Сокет SOCK_SEQPACKET: каждое сообщение приходит целиком. Клиент один
+   за раз; следующий подключается после отключения предыдущего. */
+
+#define SHM_MAGIC 0x5344424F // "OBDS"
+#define SHM_VERSION 1
+#define SHM_MAX_RECTS 64 // Больше прямоугольников - обновляется весь кадр
+
+enum { SHM_FORMAT_BGRA = 1 }; // Формат кадра pixfmt: BGRA, строки выровнены
+
+enum { SHM_HELLO = 1, SHM_DAMAGE, SHM_DONE, SHM_EVENT };
+
+// Все поля 32-битные, как в DisplayEvent
+
+// Сервер -> клиент при подключении, вместе с дескриптором memfd
+typedef struct ShmHello {
+  int32_t type, magic, version;
+  int32_t width, height, stride, format;
+} ShmHello;
+
+// Клиент -> сервер; count == 0 - весь кадр
+typedef struct ShmDamage {
+  int32_t type, serial, count;
+  DisplayRect rects[SHM_MAX_RECTS];
+} ShmDamage;
+
+// Сервер -> клиент: кадр с этим номером выведен, его можно менять
+typedef struct ShmDone {
+  int32_t type, serial;
+} ShmDone;
+
+// Сервер -> клиент: событие ввода из окна
+typedef struct ShmEvent {
+  int32_t type;
+  DisplayEvent event;
+} ShmEvent;
+
+// Отправка сообщения и, если fd >= 0, дескриптора вместе с ним. 1 при успехе
+int shm_send(int sock, const void *msg, int size, int fd);
+
+// Сервер (shmserver.c)
+
+/* Начинает слушать сокет path в отдельном потоке. Нужен кадр в memfd
+   (d->fd >= 0). Возвращает 1 при успехе. */
+int shm_serve(Display *d, const char *path);
+void shm_stop(void);
+/* Из потока окна: выводит кадр, если клиент прислал изменения, и
+   отвечает ему SHM_DONE. Возвращает 1, если кадр выведен. Поток сокета
+   будит NextEvent через glfwPostEmptyEvent, так что цикл сервера может
+   ждать событий без таймаута. */
+int shm_poll(Display *d);
+// Пересылает событие окна клиенту; 0, если клиента нет
+int shm_forward(const DisplayEvent *event);
+
+// Клиент (shm.c), без GL
+
+typedef struct ShmClient {
+  int sock;
+  unsigned char *pixels; // Общий с сервером кадр
+  int width, height, stride;
+  int32_t serial; // Номер последнего отправленного кадра
+} ShmClient;
+
+ShmClient *shm_connect(const char *path);
+void shm_disconnect(ShmClient *c);
+// Сообщает об изменениях в кадре (count == 0 - весь кадр); 1 при успехе
+int shm_damage(ShmClient *c, const DisplayRect *rects, int count);
+/* Ждёт сообщения от сервера. timeoutMs как в NextEvent. Возвращает
+   SHM_DONE (serial - номер кадра), SHM_EVENT (событие в event),
+   0 по таймауту и -1, если сервер отключился. */
+int shm_wait(ShmClient *c, DisplayEvent *event, int32_t *serial, int timeoutMs);
+
+#endif
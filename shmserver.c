@@ -0,0 +1,214 @@
+#define _GNU_SOURCE // accept4, pipe2
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "shm.h"
+
+static Display *display;
+static char socketPath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static int listenFd = -1;
+static pthread_t thread;
+static volatile int running;
+static int wakeFds[2] = { -1, -1 }; // Будит поток сокета: SHM_DONE ждёт места в сокете
+
+// Общее с потоком сокета, под lock
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static int clientFd = -1;
+static DisplayRect damage[SHM_MAX_RECTS];
+static int damageCount; // -1 - весь кадр
+static int damaged; // Есть невыведенные изменения
+static int32_t damageSerial;
+static int donePending; // SHM_DONE не ушёл: сокет клиента был полон
+static int32_t doneSerial;
+
+// Под lock
+static void send_done(void) {
+  ShmDone done = { SHM_DONE, doneSerial };
+  int was = donePending;
+
+  donePending = clientFd >= 0 && !shm_send(clientFd, &done, sizeof(done), -1) && errno == EAGAIN;
+  if (donePending && !was) (void)!write(wakeFds[1], "", 1); // Поток сокета начнёт ждать места
+}
+
+// Сообщения одного клиента до его отключения
+static void serve_client(int fd) {
+  ShmHello hello = {
+    SHM_HELLO, SHM_MAGIC, SHM_VERSION,
+    display->width, display->height, display->stride, SHM_FORMAT_BGRA
+  };
+  ShmDamage msg;
+  struct pollfd p[2] = { { fd, POLLIN, 0 }, { wakeFds[0], POLLIN, 0 } };
+  char drain[16];
+  ssize_t n;
+  int count;
+
+  if (!shm_send(fd, &hello, sizeof(hello), display->fd)) return;
+  for (;;) {
+    /* SHM_DONE, не ушедший из потока окна, досылается отсюда: клиент
+       ничего не пришлёт, пока его не получит, и поток окна может так и
+       не проснуться */
+    pthread_mutex_lock(&lock);
+    p[0].events = donePending ? POLLIN | POLLOUT : POLLIN;
+    pthread_mutex_unlock(&lock);
+    if (poll(p, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    if (p[1].revents & POLLIN) while (read(wakeFds[0], drain, sizeof(drain)) > 0);
+    if (p[0].revents & POLLOUT) {
+      pthread_mutex_lock(&lock);
+      if (donePending) send_done();
+      pthread_mutex_unlock(&lock);
+    }
+    if (!(p[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+    if ((n = recv(fd, &msg, sizeof(msg), MSG_DONTWAIT)) <= 0) {
+      if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+      return;
+    }
+    if (msg.type != SHM_DAMAGE || n < (ssize_t)offsetof(ShmDamage, rects)) continue;
+    count = msg.count > SHM_MAX_RECTS ? 0 : msg.count;
+    if (count < 0 || n < (ssize_t)(offsetof(ShmDamage, rects) + count * sizeof(DisplayRect))) continue;
+    pthread_mutex_lock(&lock);
+    // Изменения копятся, пока поток окна их не вывел
+    if (count == 0 || damageCount < 0 || damageCount + count > SHM_MAX_RECTS) {
+      damageCount = -1;
+    } else {
+      memcpy(&damage[damageCount], msg.rects, count * sizeof(DisplayRect));
+      damageCount += count;
+    }
+    damaged = 1;
+    damageSerial = msg.serial;
+    pthread_mutex_unlock(&lock);
+    glfwPostEmptyEvent();
+  }
+}
+
+static void *listen_thread(void *arg) {
+  int fd;
+
+  (void)arg;
+  while (running) {
+    fd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      break; // shm_stop закрыл сокет
+    }
+    pthread_mutex_lock(&lock);
+    clientFd = fd;
+    damageCount = 0;
+    damaged = donePending = 0;
+    doneSerial = damageSerial = 0;
+    pthread_mutex_unlock(&lock);
+
+    serve_client(fd);
+
+    pthread_mutex_lock(&lock);
+    clientFd = -1;
+    close(fd);
+    pthread_mutex_unlock(&lock);
+  }
+  return NULL;
+}
+
+static void close_wake(void) {
+  for (int i = 0; i < 2; i++) {
+    if (wakeFds[i] >= 0) close(wakeFds[i]);
+    wakeFds[i] = -1;
+  }
+}
+
+int shm_serve(Display *d, const char *path) {
+  struct sockaddr_un addr = { 0 };
+
+  if (d->fd < 0 || running || strlen(path) >= sizeof(addr.sun_path)) return 0;
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  if (pipe2(wakeFds, O_CLOEXEC | O_NONBLOCK)) return 0;
+  listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (listenFd < 0) {
+    close_wake();
+    return 0;
+  }
+  unlink(path); // Сокет от упавшего сервера
+  if (bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) || listen(listenFd, 1)) {
+    fprintf(stderr, "shm: %s: %s\n", path, strerror(errno));
+    close(listenFd);
+    listenFd = -1;
+    close_wake();
+    return 0;
+  }
+  strcpy(socketPath, path);
+  display = d;
+  running = 1;
+  if (pthread_create(&thread, NULL, listen_thread, NULL)) {
+    running = 0;
+    close(listenFd);
+    listenFd = -1;
+    close_wake();
+    unlink(path);
+    return 0;
+  }
+  return 1;
+}
+
+void shm_stop(void) {
+  if (!running) return;
+  running = 0;
+  // Будит accept и recv в потоке сокета
+  shutdown(listenFd, SHUT_RDWR);
+  pthread_mutex_lock(&lock);
+  if (clientFd >= 0) shutdown(clientFd, SHUT_RDWR);
+  pthread_mutex_unlock(&lock);
+  pthread_join(thread, NULL);
+  close(listenFd);
+  listenFd = -1;
+  close_wake();
+  unlink(socketPath);
+}
+
+int shm_poll(Display *d) {
+  DisplayRect rects[SHM_MAX_RECTS];
+  int count;
+
+  pthread_mutex_lock(&lock);
+  if (donePending) send_done();
+  if (!damaged) {
+    pthread_mutex_unlock(&lock);
+    return 0;
+  }
+  count = damageCount;
+  if (count > 0) memcpy(rects, damage, count * sizeof(DisplayRect));
+  damageCount = 0;
+  damaged = 0;
+  doneSerial = damageSerial;
+  pthread_mutex_unlock(&lock);
+
+  // Клиент не пишет в кадр до SHM_DONE, так что загрузка идёт без блокировки
+  Flush(d, rects, count < 0 ? 0 : count);
+
+  pthread_mutex_lock(&lock);
+  send_done();
+  pthread_mutex_unlock(&lock);
+  return 1;
+}
+
+int shm_forward(const DisplayEvent *event) {
+  ShmEvent msg;
+  int sent = 0;
+
+  msg.type = SHM_EVENT;
+  msg.event = *event;
+  pthread_mutex_lock(&lock);
+  // Если клиент не читает события, лишние теряются, а не задерживают окно
+  if (clientFd >= 0) sent = shm_send(clientFd, &msg, sizeof(msg), -1);
+  pthread_mutex_unlock(&lock);
+  return sent;
+}
@@ -0,0 +1,278 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pixfmt.h"
+#include "sprites.h"
+
+// Данные одного экземпляра в буфере GL
+typedef struct SpriteInst {
+  float rect[4]; // x, y, w, h в пикселях
+  float uv[4]; // u0, v0, u1, v1
+  unsigned int color; // 0xAARRGGBB
+} SpriteInst;
+
+typedef struct Sprite {
+  SpriteInst inst;
+  GLuint texture;
+  int layer;
+} Sprite;
+
+static const char *vertexSource = "#version 330 core\n"
+    "layout (location = 0) in vec4 aRect;\n"
+    "layout (location = 1) in vec4 aUV;\n"
+    "layout (location = 2) in vec4 aColor;\n"
+    "uniform vec2 target;\n"
+    "out vec2 TexCoord;\n"
+    "out vec4 Color;\n"
+    "void main() {\n"
+    "  vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+    "  vec2 pos = (aRect.xy + corner * aRect.zw) / target * 2.0 - 1.0;\n"
+    "  gl_Position = vec4(pos.x, -pos.y, 0.0, 1.0);\n"
+    "  TexCoord = mix(aUV.xy, aUV.zw, corner);\n"
+    "  Color = aColor;\n"
+    "}\n";
+
+static const char *fragmentSource = "#version 330 core\n"
+    "in vec2 TexCoord;\n"
+    "in vec4 Color;\n"
+    "uniform sampler2D tex;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "  FragColor = texture(tex, TexCoord) * Color;\n"
+    "}\n";
+
+static GLuint program, vao, vbo, white;
+static GLint targetLocation;
+static size_t vboSize;
+
+static Sprite *sprites;
+static int count, capacity, keysCapacity;
+static uint64_t *keys; // Ключи сортировки: слой, текстура, порядковый номер
+static SpriteInst *stream; // Отсортированные экземпляры для загрузки
+static int layer;
+static int clipOn;
+static float clipX0, clipY0, clipX1, clipY1;
+static float targetW, targetH;
+
+static GLuint compile(GLenum type, const char *source) {
+  GLuint shader = glCreateShader(type);
+  GLint success;
+
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  if (!success) {
+    char infoLog[512];
+    glGetShaderInfoLog(shader, 512, NULL, infoLog);
+    fprintf(stderr, "Ошибка компиляции шейдера спрайтов: %s\n", infoLog);
+  }
+  return shader;
+}
+
+GLuint sprite_init(const char *fragment) {
+  static const unsigned int whitePixel = SPRITE_WHITE;
+  GLuint vs = compile(GL_VERTEX_SHADER, vertexSource);
+  GLuint fs = compile(GL_FRAGMENT_SHADER, fragment ? fragment : fragmentSource);
+  GLint success;
+
+  program = glCreateProgram();
+  glAttachShader(program, vs);
+  glAttachShader(program, fs);
+  glLinkProgram(program);
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success) {
+    char infoLog[512];
+    glGetProgramInfoLog(program, 512, NULL, infoLog);
+    fprintf(stderr, "Ошибка линковки шейдера спрайтов: %s\n", infoLog);
+  }
+  glDeleteShader(vs);
+  glDeleteShader(fs);
+  targetLocation = glGetUniformLocation(program, "target");
+  glUseProgram(program);
+  glUniform1i(glGetUniformLocation(program, "tex"), 0);
+
+  // Углы прямоугольника берутся из gl_VertexID, вершинный буфер не нужен
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &vbo);
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  for (int i = 0; i < 3; i++) {
+    glEnableVertexAttribArray(i);
+    glVertexAttribDivisor(i, 1);
+  }
+  glBindVertexArray(0);
+
+  // Текстура для прямоугольников без картинки
+  white = pix_create_texture(1, 1, &whitePixel, PIX_BPP);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  return program;
+}
+
+void sprite_shutdown(void) {
+  glDeleteTextures(1, &white);
+  glDeleteBuffers(1, &vbo);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteProgram(program);
+  free(sprites);
+  free(keys);
+  free(stream);
+  sprites = NULL;
+  keys = NULL;
+  stream = NULL;
+  count = capacity = keysCapacity = 0;
+  vboSize = 0;
+}
+
+void sprite_begin(int width, int height) {
+  targetW = width;
+  targetH = height;
+  count = 0;
+  layer = 0;
+  clipOn = 0;
+}
+
+void sprite_layer(int layer_) {
+  layer = layer_;
+}
+
+void sprite_clip(float x, float y, float w, float h) {
+  clipOn = 1;
+  clipX0 = x;
+  clipY0 = y;
+  clipX1 = x + w;
+  clipY1 = y + h;
+}
+
+void sprite_noclip(void) {
+  clipOn = 0;
+}
+
+void sprite_draw(GLuint texture, float x, float y, float w, float h,
+    float u0, float v0, float u1, float v1, unsigned int color) {
+  Sprite *s;
+
+  if (w <= 0 || h <= 0) return;
+  if (clipOn) { // Обрезка с пересчётом текстурных координат
+    float x1 = x + w, y1 = y + h;
+    float du = (u1 - u0) / w, dv = (v1 - v0) / h;
+    if (x >= clipX1 || y >= clipY1 || x1 <= clipX0 || y1 <= clipY0) return;
+    if (x < clipX0) { u0 += (clipX0 - x) * du; x = clipX0; }
+    if (y < clipY0) { v0 += (clipY0 - y) * dv; y = clipY0; }
+    if (x1 > clipX1) { u1 -= (x1 - clipX1) * du; x1 = clipX1; }
+    if (y1 > clipY1) { v1 -= (y1 - clipY1) * dv; y1 = clipY1; }
+    w = x1 - x;
+    h = y1 - y;
+  }
+
+  if (count == capacity) {
+    int n = capacity ? capacity * 2 : 1024;
+    Sprite *ns = realloc(sprites, sizeof(Sprite) * n);
+    if (!ns) return;
+    sprites = ns;
+    capacity = n;
+  }
+  s = &sprites[count++];
+  s->inst.rect[0] = x;
+  s->inst.rect[1] = y;
+  s->inst.rect[2] = w;
+  s->inst.rect[3] = h;
+  s->inst.uv[0] = u0;
+  s->inst.uv[1] = v0;
+  s->inst.uv[2] = u1;
+  s->inst.uv[3] = v1;
+  s->inst.color = color;
+  s->texture = texture ? texture : white;
+  s->layer = layer;
+}
+
+void sprite_rect(float x, float y, float w, float h, unsigned int color) {
+  sprite_draw(0, x, y, w, h, 0, 0, 1, 1, color);
+}
+
+static int compare_keys(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+/* Ключ: слой (16 бит со сдвигом знака), номер текстуры (16 бит) и
+   порядковый номер спрайта (32 бита), чтобы сортировка была устойчивой */
+static uint64_t sort_key(const Sprite *s, int i) {
+  return (uint64_t)((s->layer + 0x8000) & 0xFFFF) << 48
+      | (uint64_t)(s->texture & 0xFFFF) << 32 | (uint32_t)i;
+}
+
+static int sort_sprites(void) {
+  int sorted = 1;
+
+  if (keysCapacity < capacity) {
+    uint64_t *nk = realloc(keys, sizeof(uint64_t) * capacity);
+    SpriteInst *ns = nk ? realloc(stream, sizeof(SpriteInst) * capacity) : NULL;
+    if (nk) keys = nk;
+    if (!ns) return 0;
+    stream = ns;
+    keysCapacity = capacity;
+  }
+  for (int i = 0; i < count; i++) {
+    keys[i] = sort_key(&sprites[i], i);
+    if (i > 0 && keys[i] < keys[i - 1]) sorted = 0;
+  }
+  if (!sorted) qsort(keys, count, sizeof(uint64_t), compare_keys);
+  for (int i = 0; i < count; i++) stream[i] = sprites[(uint32_t)keys[i]].inst;
+  return 1;
+}
+
+static void set_pointers(size_t first) {
+  size_t base = first * sizeof(SpriteInst);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInst),
+      (void *)(base + offsetof(SpriteInst, rect)));
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInst),
+      (void *)(base + offsetof(SpriteInst, uv)));
+  // GL_BGRA: байты B, G, R, A цвета 0xAARRGGBB сразу приходят как rgba
+  glVertexAttribPointer(2, GL_BGRA, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteInst),
+      (void *)(base + offsetof(SpriteInst, color)));
+}
+
+void sprite_end(void) {
+  size_t size;
+  int first;
+
+  if (count == 0) return;
+  if (!sort_sprites()) {
+    count = 0;
+    return;
+  }
+
+  glUseProgram(program);
+  glUniform2f(targetLocation, targetW, targetH);
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+  // Сброс старого содержимого: драйвер не ждёт, пока GPU дорисует прошлый кадр
+  size = sizeof(SpriteInst) * count;
+  if (size > vboSize) vboSize = size;
+  glBufferData(GL_ARRAY_BUFFER, vboSize, NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, size, stream);
+
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glActiveTexture(GL_TEXTURE0);
+
+  // Одна отрисовка на каждый отрезок подряд идущих спрайтов одной текстуры
+  for (first = 0; first < count; ) {
+    GLuint texture = sprites[(uint32_t)keys[first]].texture;
+    int last = first + 1;
+    while (last < count && sprites[(uint32_t)keys[last]].texture == texture) last++;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    set_pointers(first);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, last - first);
+    first = last;
+  }
+
+  glDisable(GL_BLEND);
+  glBindVertexArray(0);
+  count = 0;
+}
@@ -0,0 +1,42 @@
+#ifndef SPRITES_H
+#define SPRITES_H
+
+#include <GL/glew.h>
+
+/* Пакетная отрисовка 2D-прямоугольников (спрайтов) вместо glBegin/glEnd.
+   Спрайты между sprite_begin и sprite_end копятся в массиве, при
+   sprite_end сортируются по слою и текстуре, одним куском грузятся в
+   потоковый буфер экземпляров и рисуются одним glDrawArraysInstanced
+   на каждую смену текстуры. Координаты - в пикселях цели отрисовки,
+   (0, 0) - левый верхний угол.
+
+   Внутри одного слоя порядок спрайтов с разными текстурами не
+   сохраняется (они группируются по текстуре); если перекрытие важно,
+   спрайты разносятся по слоям. Спрайты одной текстуры в слое рисуются
+   в порядке добавления. */
+
+#define SPRITE_WHITE 0xFFFFFFFFu // Цвет 0xAARRGGBB: без подкраски
+
+/* Нужен текущий GL-контекст. fragmentSource == NULL - обычный шейдер;
+   свой шейдер получает in vec2 TexCoord, in vec4 Color и uniform
+   sampler2D tex. Возвращает программу (для своих uniform). */
+GLuint sprite_init(const char *fragmentSource);
+void sprite_shutdown(void);
+
+// Начало кадра: размер цели в пикселях
+void sprite_begin(int width, int height);
+void sprite_end(void);
+
+// Слой для следующих спрайтов; меньшие слои рисуются раньше
+void sprite_layer(int layer);
+// Отсечение прямоугольником (обрезаются сами спрайты, без смены состояния GL)
+void sprite_clip(float x, float y, float w, float h);
+void sprite_noclip(void);
+
+// Часть (u0, v0)-(u1, v1) текстуры в прямоугольник, умноженная на цвет color
+void sprite_draw(GLuint texture, float x, float y, float w, float h,
+    float u0, float v0, float u1, float v1, unsigned int color);
+// Прямоугольник одного цвета
+void sprite_rect(float x, float y, float w, float h, unsigned int color);
+
+#endif
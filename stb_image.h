@@ -523,6 +523,36 @@ STBIDEF void stbi_set_unpremultiply_on_load_thread(int flag_true_if_should_unpre
 STBIDEF void stbi_convert_iphone_png_to_rgb_thread(int flag_true_if_should_convert);
 STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_flip);
 
+// glfw-experiments: decode JPEGs straight into caller memory. Once the header
+// is parsed, func is asked for room for x*y pixels of comp channels and returns
+// a pointer and the row stride in bytes (or NULL for the usual malloc'd result).
+// stbi_load* then returns that pointer, which must not go to stbi_image_free.
+// swap_rb writes B,G,R(,A) instead of R,G,B(,A). Other formats, and loads with
+// flip-on-load set, ignore the destination. Thread-local like the above.
+typedef stbi_uc *stbi_dest_func(void *user, int x, int y, int comp, int *stride);
+STBIDEF void stbi_set_output_destination_thread(stbi_dest_func *func, void *user, int swap_rb);
+
+// glfw-experiments: reduced-resolution JPEG decoding. JPEGs are decoded at
+// 1/2, 1/4 or 1/8 scale, the least reduction that fits into max_x*max_y
+// (1/8 if nothing fits), using a reduced IDCT on the low coefficients only.
+// stbi_info* reports the reduced size too. 0,0 turns it off. Thread-local.
+STBIDEF void stbi_set_jpeg_max_size_thread(int max_x, int max_y);
+
+// glfw-experiments: parallel JPEG decoding. run(func, task, count) must call
+// func(task, i) for every i in 0..count-1, on any threads, and return once all
+// calls are done; the calls don't allocate. Used for the IDCT of progressive
+// JPEGs and for resampling/colour conversion (both by rows), and for entropy
+// decoding of baseline JPEGs with restart markers when loading from memory.
+// NULL (the default) decodes on the calling thread. Thread-local.
+typedef void stbi_job_func(void *task, int index);
+typedef void stbi_parallel_func(stbi_job_func *func, void *task, int count);
+STBIDEF void stbi_set_parallel_thread(stbi_parallel_func *run);
+
+// glfw-experiments: the widest JPEG kernels to use: 0 generic C, 1 SSE2/NEON,
+// 2 AVX2 (the default; each level still needs CPU support). For testing the
+// SIMD paths against each other. Global, read when a decode starts.
+STBIDEF void stbi_set_jpeg_simd(int level);
+
 // ZLIB client - used by PNG, available for other purposes
 
 STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
@@ -749,7 +779,7 @@ static int stbi__cpuid3(void)
 
 #define STBI_SIMD_ALIGN(type, name) __declspec(align(16)) type name
 
-#if !defined(STBI_NO_JPEG) && defined(STBI_SSE2)
+#if (!defined(STBI_NO_JPEG) || !defined(STBI_NO_PNG)) && defined(STBI_SSE2)
 static int stbi__sse2_available(void)
 {
    int info3 = stbi__cpuid3();
@@ -760,7 +790,7 @@ static int stbi__sse2_available(void)
 #else // assume GCC-style if not VC++
 #define STBI_SIMD_ALIGN(type, name) type name __attribute__((aligned(16)))
 
-#if !defined(STBI_NO_JPEG) && defined(STBI_SSE2)
+#if (!defined(STBI_NO_JPEG) || !defined(STBI_NO_PNG)) && defined(STBI_SSE2)
 static int stbi__sse2_available(void)
 {
    // If we're even attempting to compile this on GCC/Clang, that means
@@ -770,6 +800,18 @@ static int stbi__sse2_available(void)
 }
 #endif
 
+// AVX2 kernels are compiled with a per-function target attribute and
+// picked at runtime, so the rest of the library still only needs SSE2.
+#if !defined(STBI_NO_JPEG) && !defined(STBI_NO_AVX2)
+#define STBI_AVX2
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+static int stbi__avx2_available(void)
+{
+   return __builtin_cpu_supports("avx2");
+}
+#endif
+
 #endif
 #endif
 
@@ -1112,6 +1154,13 @@ static stbi_uc *stbi__hdr_to_ldr(float   *data, int x, int y, int comp);
 
 static int stbi__vertically_flip_on_load_global = 0;
 
+static int stbi__jpeg_simd = 2;
+
+STBIDEF void stbi_set_jpeg_simd(int level)
+{
+   stbi__jpeg_simd = level;
+}
+
 STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip)
 {
    stbi__vertically_flip_on_load_global = flag_true_if_should_flip;
@@ -1133,6 +1182,47 @@ STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_fli
                                          : stbi__vertically_flip_on_load_global)
 #endif // STBI_THREAD_LOCAL
 
+#ifdef STBI_THREAD_LOCAL
+static STBI_THREAD_LOCAL stbi_dest_func *stbi__dest_func;
+static STBI_THREAD_LOCAL void *stbi__dest_user;
+static STBI_THREAD_LOCAL int stbi__dest_swap_rb;
+
+STBIDEF void stbi_set_output_destination_thread(stbi_dest_func *func, void *user, int swap_rb)
+{
+   stbi__dest_func = func;
+   stbi__dest_user = user;
+   stbi__dest_swap_rb = swap_rb;
+}
+
+static STBI_THREAD_LOCAL int stbi__jpeg_max_x, stbi__jpeg_max_y;
+
+STBIDEF void stbi_set_jpeg_max_size_thread(int max_x, int max_y)
+{
+   stbi__jpeg_max_x = max_x;
+   stbi__jpeg_max_y = max_y;
+}
+
+static STBI_THREAD_LOCAL stbi_parallel_func *stbi__parallel;
+
+STBIDEF void stbi_set_parallel_thread(stbi_parallel_func *run)
+{
+   stbi__parallel = run;
+}
+#else
+#define stbi__parallel ((stbi_parallel_func *) 0)
+#endif // STBI_THREAD_LOCAL
+
+static void stbi__run_jobs(stbi_job_func *func, void *task, int count)
+{
+   int i;
+   if (stbi__parallel && count > 1) {
+      stbi__parallel(func, task, count);
+      return;
+   }
+   for (i=0; i < count; ++i)
+      func(task, i);
+}
+
 static void *stbi__load_main(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri, int bpc)
 {
    memset(ri, 0, sizeof(*ri)); // make sure it's initialized if we add new fields
@@ -1992,6 +2082,7 @@ typedef struct
 
    int scan_n, order[4];
    int restart_interval, todo;
+   int scale_shift; // output is reduced by 1 << scale_shift
 
 // kernels
    void (*idct_block_kernel)(stbi_uc *out, int out_stride, short data[64]);
@@ -2522,6 +2613,53 @@ static void stbi__idct_block(stbi_uc *out, int out_stride, short data[64])
    }
 }
 
+// reduced IDCT: an NxN block from the low NxN coefficients, N = 8 >> shift.
+// weights are C(u)/2 * the mean of cos((2x+1)u*pi/16) over the full-size
+// pixels x that collapse into one output pixel, in 12-bit fixed point, so
+// each output is the box average of those pixels minus the dropped terms.
+static const short stbi__idct4_w[4][4] = {
+   { 1448,  1856,  1338,   652 },
+   { 1448,   769, -1338, -1573 },
+   { 1448,  -769, -1338,  1573 },
+   { 1448, -1856,  1338,  -652 },
+};
+static const short stbi__idct2_w[2][2] = {
+   { 1448,  1312 },
+   { 1448, -1312 },
+};
+
+static void stbi__idct_scaled(stbi_uc *out, int out_stride, short data[64], int shift)
+{
+   int i,k,u,n,tmp[4][4];
+   const short *w;
+   if (shift >= 3) {
+      // DC only: the same value the full IDCT produces for a flat block
+      out[0] = stbi__clamp(((data[0] + 4) >> 3) + 128);
+      return;
+   }
+   n = 8 >> shift;
+   w = shift == 1 ? &stbi__idct4_w[0][0] : &stbi__idct2_w[0][0];
+   // rows of coefficients -> n samples each, kept with 2 extra bits.
+   // outputs k and n-1-k share the even terms and negate the odd ones
+   for (i=0; i < n; ++i)
+      for (k=0; k < n/2; ++k) {
+         int e = 0, o = 0;
+         for (u=0; u < n; u += 2) e += w[k*n+u] * data[i*8+u];
+         for (u=1; u < n; u += 2) o += w[k*n+u] * data[i*8+u];
+         tmp[i][k]     = (e + o + (1 << 9)) >> 10;
+         tmp[i][n-1-k] = (e - o + (1 << 9)) >> 10;
+      }
+   // columns
+   for (k=0; k < n; ++k)
+      for (i=0; i < n/2; ++i) {
+         int e = 0, o = 0;
+         for (u=0; u < n; u += 2) e += w[i*n+u] * tmp[u][k];
+         for (u=1; u < n; u += 2) o += w[i*n+u] * tmp[u][k];
+         out[i*out_stride + k]       = stbi__clamp(((e + o + (1 << 13)) >> 14) + 128);
+         out[(n-1-i)*out_stride + k] = stbi__clamp(((e - o + (1 << 13)) >> 14) + 128);
+      }
+}
+
 #ifdef STBI_SSE2
 // sse2 integer IDCT. not the fastest possible implementation but it
 // produces bit-identical results to the generic C version so it's
@@ -2703,6 +2841,127 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
 
 #endif // STBI_SSE2
 
+#ifdef STBI_AVX2
+// avx2 integer IDCT. a direct port of the generic C version with one
+// 32-bit lane per column, so it is bit-identical to it as well (and to
+// the sse2 one).
+#define STBI__IDCT_1D_AVX2(s0,s1,s2,s3,s4,s5,s6,s7) \
+   __m256i t0,t1,t2,t3,p1,p2,p3,p4,p5,x0,x1,x2,x3; \
+   p1 = _mm256_mullo_epi32(_mm256_add_epi32(s2,s6), _mm256_set1_epi32(stbi__f2f(0.5411961f))); \
+   t2 = _mm256_add_epi32(p1, _mm256_mullo_epi32(s6, _mm256_set1_epi32(stbi__f2f(-1.847759065f)))); \
+   t3 = _mm256_add_epi32(p1, _mm256_mullo_epi32(s2, _mm256_set1_epi32(stbi__f2f( 0.765366865f)))); \
+   t0 = _mm256_slli_epi32(_mm256_add_epi32(s0,s4), 12); \
+   t1 = _mm256_slli_epi32(_mm256_sub_epi32(s0,s4), 12); \
+   x0 = _mm256_add_epi32(t0,t3); \
+   x3 = _mm256_sub_epi32(t0,t3); \
+   x1 = _mm256_add_epi32(t1,t2); \
+   x2 = _mm256_sub_epi32(t1,t2); \
+   p3 = _mm256_add_epi32(s7,s3); \
+   p4 = _mm256_add_epi32(s5,s1); \
+   p1 = _mm256_add_epi32(s7,s1); \
+   p2 = _mm256_add_epi32(s5,s3); \
+   p5 = _mm256_mullo_epi32(_mm256_add_epi32(p3,p4), _mm256_set1_epi32(stbi__f2f( 1.175875602f))); \
+   t0 = _mm256_mullo_epi32(s7, _mm256_set1_epi32(stbi__f2f( 0.298631336f))); \
+   t1 = _mm256_mullo_epi32(s5, _mm256_set1_epi32(stbi__f2f( 2.053119869f))); \
+   t2 = _mm256_mullo_epi32(s3, _mm256_set1_epi32(stbi__f2f( 3.072711026f))); \
+   t3 = _mm256_mullo_epi32(s1, _mm256_set1_epi32(stbi__f2f( 1.501321110f))); \
+   p1 = _mm256_add_epi32(p5, _mm256_mullo_epi32(p1, _mm256_set1_epi32(stbi__f2f(-0.899976223f)))); \
+   p2 = _mm256_add_epi32(p5, _mm256_mullo_epi32(p2, _mm256_set1_epi32(stbi__f2f(-2.562915447f)))); \
+   p3 = _mm256_mullo_epi32(p3, _mm256_set1_epi32(stbi__f2f(-1.961570560f))); \
+   p4 = _mm256_mullo_epi32(p4, _mm256_set1_epi32(stbi__f2f(-0.390180644f))); \
+   t3 = _mm256_add_epi32(t3, _mm256_add_epi32(p1,p4)); \
+   t2 = _mm256_add_epi32(t2, _mm256_add_epi32(p2,p3)); \
+   t1 = _mm256_add_epi32(t1, _mm256_add_epi32(p2,p4)); \
+   t0 = _mm256_add_epi32(t0, _mm256_add_epi32(p1,p3));
+
+// 8x8 transpose of 32-bit elements
+#define STBI__TRANSPOSE_AVX2(r0,r1,r2,r3,r4,r5,r6,r7) { \
+   __m256i a0 = _mm256_unpacklo_epi32(r0,r1), a1 = _mm256_unpackhi_epi32(r0,r1); \
+   __m256i a2 = _mm256_unpacklo_epi32(r2,r3), a3 = _mm256_unpackhi_epi32(r2,r3); \
+   __m256i a4 = _mm256_unpacklo_epi32(r4,r5), a5 = _mm256_unpackhi_epi32(r4,r5); \
+   __m256i a6 = _mm256_unpacklo_epi32(r6,r7), a7 = _mm256_unpackhi_epi32(r6,r7); \
+   __m256i b0 = _mm256_unpacklo_epi64(a0,a2), b1 = _mm256_unpackhi_epi64(a0,a2); \
+   __m256i b2 = _mm256_unpacklo_epi64(a1,a3), b3 = _mm256_unpackhi_epi64(a1,a3); \
+   __m256i b4 = _mm256_unpacklo_epi64(a4,a6), b5 = _mm256_unpackhi_epi64(a4,a6); \
+   __m256i b6 = _mm256_unpacklo_epi64(a5,a7), b7 = _mm256_unpackhi_epi64(a5,a7); \
+   r0 = _mm256_permute2x128_si256(b0,b4,0x20); r4 = _mm256_permute2x128_si256(b0,b4,0x31); \
+   r1 = _mm256_permute2x128_si256(b1,b5,0x20); r5 = _mm256_permute2x128_si256(b1,b5,0x31); \
+   r2 = _mm256_permute2x128_si256(b2,b6,0x20); r6 = _mm256_permute2x128_si256(b2,b6,0x31); \
+   r3 = _mm256_permute2x128_si256(b3,b7,0x20); r7 = _mm256_permute2x128_si256(b3,b7,0x31); \
+   }
+
+STBI__AVX2_TARGET
+static void stbi__idct_avx2(stbi_uc *out, int out_stride, short data[64])
+{
+   __m256i r0,r1,r2,r3,r4,r5,r6,r7;
+   __m256i lo, hi, idx;
+
+   // load rows; lane k of row n is coefficient (n,k)
+   r0 = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) (data +  0)));
+   r1 = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) (data +  8)));
+   r2 = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) (data + 16)));
+   r3 = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) (data + 24)));
+   r4 = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) (data + 32)));
+   r5 = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) (data + 40)));
+   r6 = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) (data + 48)));
+   r7 = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) (data + 56)));
+
+   // columns, all eight at once. the generic version's all-zero shortcut
+   // gives the same result as the full transform, so it isn't needed here
+   {
+      __m256i bias = _mm256_set1_epi32(512);
+      STBI__IDCT_1D_AVX2(r0,r1,r2,r3,r4,r5,r6,r7)
+      x0 = _mm256_add_epi32(x0, bias); x1 = _mm256_add_epi32(x1, bias);
+      x2 = _mm256_add_epi32(x2, bias); x3 = _mm256_add_epi32(x3, bias);
+      r0 = _mm256_srai_epi32(_mm256_add_epi32(x0,t3), 10);
+      r7 = _mm256_srai_epi32(_mm256_sub_epi32(x0,t3), 10);
+      r1 = _mm256_srai_epi32(_mm256_add_epi32(x1,t2), 10);
+      r6 = _mm256_srai_epi32(_mm256_sub_epi32(x1,t2), 10);
+      r2 = _mm256_srai_epi32(_mm256_add_epi32(x2,t1), 10);
+      r5 = _mm256_srai_epi32(_mm256_sub_epi32(x2,t1), 10);
+      r3 = _mm256_srai_epi32(_mm256_add_epi32(x3,t0), 10);
+      r4 = _mm256_srai_epi32(_mm256_sub_epi32(x3,t0), 10);
+   }
+
+   // rows: transpose so that lane k holds row k, transform, transpose back
+   STBI__TRANSPOSE_AVX2(r0,r1,r2,r3,r4,r5,r6,r7)
+   {
+      __m256i bias = _mm256_set1_epi32(65536 + (128<<17));
+      STBI__IDCT_1D_AVX2(r0,r1,r2,r3,r4,r5,r6,r7)
+      x0 = _mm256_add_epi32(x0, bias); x1 = _mm256_add_epi32(x1, bias);
+      x2 = _mm256_add_epi32(x2, bias); x3 = _mm256_add_epi32(x3, bias);
+      r0 = _mm256_srai_epi32(_mm256_add_epi32(x0,t3), 17);
+      r7 = _mm256_srai_epi32(_mm256_sub_epi32(x0,t3), 17);
+      r1 = _mm256_srai_epi32(_mm256_add_epi32(x1,t2), 17);
+      r6 = _mm256_srai_epi32(_mm256_sub_epi32(x1,t2), 17);
+      r2 = _mm256_srai_epi32(_mm256_add_epi32(x2,t1), 17);
+      r5 = _mm256_srai_epi32(_mm256_sub_epi32(x2,t1), 17);
+      r3 = _mm256_srai_epi32(_mm256_add_epi32(x3,t0), 17);
+      r4 = _mm256_srai_epi32(_mm256_sub_epi32(x3,t0), 17);
+   }
+   STBI__TRANSPOSE_AVX2(r0,r1,r2,r3,r4,r5,r6,r7)
+
+   // saturating packs clamp to 0..255 like stbi__clamp; they work per
+   // 128-bit lane, so fix up the dword order before storing rows
+   idx = _mm256_setr_epi32(0,4,1,5,2,6,3,7);
+   lo = _mm256_packus_epi16(_mm256_packs_epi32(r0,r1), _mm256_packs_epi32(r2,r3));
+   hi = _mm256_packus_epi16(_mm256_packs_epi32(r4,r5), _mm256_packs_epi32(r6,r7));
+   lo = _mm256_permutevar8x32_epi32(lo, idx);
+   hi = _mm256_permutevar8x32_epi32(hi, idx);
+   _mm_storel_epi64((__m128i *) out, _mm256_castsi256_si128(lo)); out += out_stride;
+   _mm_storel_epi64((__m128i *) out, _mm_srli_si128(_mm256_castsi256_si128(lo), 8)); out += out_stride;
+   _mm_storel_epi64((__m128i *) out, _mm256_extracti128_si256(lo, 1)); out += out_stride;
+   _mm_storel_epi64((__m128i *) out, _mm_srli_si128(_mm256_extracti128_si256(lo, 1), 8)); out += out_stride;
+   _mm_storel_epi64((__m128i *) out, _mm256_castsi256_si128(hi)); out += out_stride;
+   _mm_storel_epi64((__m128i *) out, _mm_srli_si128(_mm256_castsi256_si128(hi), 8)); out += out_stride;
+   _mm_storel_epi64((__m128i *) out, _mm256_extracti128_si256(hi, 1)); out += out_stride;
+   _mm_storel_epi64((__m128i *) out, _mm_srli_si128(_mm256_extracti128_si256(hi, 1), 8));
+}
+
+#undef STBI__IDCT_1D_AVX2
+#undef STBI__TRANSPOSE_AVX2
+#endif // STBI_AVX2
+
 #ifdef STBI_NEON
 
 // NEON integer IDCT. should produce bit-identical
@@ -2945,10 +3204,137 @@ static void stbi__jpeg_reset(stbi__jpeg *j)
    // since we don't even allow 1<<30 pixels
 }
 
+// write block (bx,by) of component n, at reduced size if requested
+stbi_inline static void stbi__jpeg_idct(stbi__jpeg *z, int n, int bx, int by, short data[64])
+{
+   int shift = z->scale_shift;
+   stbi_uc *out = z->img_comp[n].data + ((z->img_comp[n].w2*by*8 + bx*8) >> shift);
+   if (shift)
+      stbi__idct_scaled(out, z->img_comp[n].w2, data, shift);
+   else
+      z->idct_block_kernel(out, z->img_comp[n].w2, data);
+}
+
+// decode and idct one baseline MCU; in a non-interleaved scan that's a
+// single block of the one component
+static int stbi__jpeg_decode_mcu(stbi__jpeg *z, int i, int j, short data[64])
+{
+   int k,x,y;
+   for (k=0; k < z->scan_n; ++k) {
+      int n = z->order[k];
+      int ha = z->img_comp[n].ha;
+      if (z->scan_n == 1) {
+         if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+         stbi__jpeg_idct(z, n, i, j, data);
+         return 1;
+      }
+      // scan out an mcu's worth of this component; that's just determined
+      // by the basic H and V specified for the component
+      for (y=0; y < z->img_comp[n].v; ++y) {
+         for (x=0; x < z->img_comp[n].h; ++x) {
+            int x2 = (i*z->img_comp[n].h + x);
+            int y2 = (j*z->img_comp[n].v + y);
+            if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+            stbi__jpeg_idct(z, n, x2, y2, data);
+         }
+      }
+   }
+   return 1;
+}
+
+// glfw-experiments: restart intervals of a baseline scan are independent
+// (the bit reader and DC predictors are reset at each RSTn), so when the
+// whole scan is in memory we find the markers up front and decode runs of
+// intervals in parallel, each job on its own copy of the decoder state.
+#define STBI__RST_MAX_JOBS 64
+
+typedef struct
+{
+   stbi__jpeg *z;
+   stbi_uc **seg;      // start of each interval
+   int intervals, per_job;
+   int mcu_x, mcu_total;
+   volatile int failed;
+} stbi__jpeg_rst_task;
+
+static void stbi__jpeg_rst_job(void *task, int index)
+{
+   stbi__jpeg_rst_task *t = (stbi__jpeg_rst_task *) task;
+   stbi__jpeg z = *t->z;
+   stbi__context s = *t->z->s;
+   STBI_SIMD_ALIGN(short, data[64]);
+   int k, last = (index+1) * t->per_job;
+
+   z.s = &s;
+   if (last > t->intervals) last = t->intervals;
+   for (k=index * t->per_job; k < last && !t->failed; ++k) {
+      int m = k * z.restart_interval;
+      int end = m + z.restart_interval < t->mcu_total ? m + z.restart_interval : t->mcu_total;
+      s.img_buffer = t->seg[k];
+      stbi__jpeg_reset(&z);
+      for (; m < end; ++m) {
+         if (!stbi__jpeg_decode_mcu(&z, m % t->mcu_x, m / t->mcu_x, data)) {
+            t->failed = 1;
+            return;
+         }
+      }
+   }
+}
+
+// returns 0 if the scan should be decoded serially instead
+static int stbi__jpeg_parallel_scan(stbi__jpeg *z)
+{
+   stbi__jpeg_rst_task t;
+   stbi_uc *p = z->s->img_buffer, *end = z->s->img_buffer_end, *scan_end = NULL;
+   int k = 0, jobs, n = z->order[0];
+
+   if (z->scan_n == 1) {
+      t.mcu_x = (z->img_comp[n].x+7) >> 3;
+      t.mcu_total = t.mcu_x * ((z->img_comp[n].y+7) >> 3);
+   } else {
+      t.mcu_x = z->img_mcu_x;
+      t.mcu_total = z->img_mcu_x * z->img_mcu_y;
+   }
+   t.intervals = (t.mcu_total + z->restart_interval - 1) / z->restart_interval;
+   if (t.intervals < 2) return 0;
+   t.seg = (stbi_uc **) stbi__malloc_mad2(t.intervals, sizeof(stbi_uc *), 0);
+   if (!t.seg) return 0;
+
+   // find the RSTn markers and the marker that ends the scan
+   t.seg[0] = p;
+   while (p < end) {
+      if (*p++ != 0xff) continue;
+      while (p < end && *p == 0xff) ++p; // fill bytes
+      if (p == end) break;
+      if (*p == 0x00) { ++p; continue; } // stuffed zero
+      if (!STBI__RESTART(*p) || k+1 == t.intervals) { scan_end = p-1; break; }
+      t.seg[++k] = ++p;
+   }
+   // anything unusual (missing or extra markers) is left to the serial path
+   if (!scan_end || k+1 != t.intervals) { STBI_FREE(t.seg); return 0; }
+
+   jobs = t.intervals < STBI__RST_MAX_JOBS ? t.intervals : STBI__RST_MAX_JOBS;
+   t.per_job = (t.intervals + jobs - 1) / jobs;
+   jobs = (t.intervals + t.per_job - 1) / t.per_job;
+   t.z = z;
+   t.failed = 0;
+   stbi__run_jobs(stbi__jpeg_rst_job, &t, jobs);
+   STBI_FREE(t.seg);
+   if (t.failed) return 0; // rerun serially to get the usual error
+
+   // leave the stream where the serial decoder would look for the next marker
+   z->s->img_buffer = scan_end;
+   stbi__jpeg_reset(z);
+   return 1;
+}
+
 static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
 {
    stbi__jpeg_reset(z);
    if (!z->progressive) {
+      if (z->restart_interval && stbi__parallel && !z->s->read_from_callbacks
+            && stbi__jpeg_parallel_scan(z))
+         return 1;
       if (z->scan_n == 1) {
          int i,j;
          STBI_SIMD_ALIGN(short, data[64]);
@@ -2961,9 +3347,7 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
          int h = (z->img_comp[n].y+7) >> 3;
          for (j=0; j < h; ++j) {
             for (i=0; i < w; ++i) {
-               int ha = z->img_comp[n].ha;
-               if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               if (!stbi__jpeg_decode_mcu(z, i, j, data)) return 0;
                // every data block is an MCU, so countdown the restart interval
                if (--z->todo <= 0) {
                   if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
@@ -2976,25 +3360,12 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
          }
          return 1;
       } else { // interleaved
-         int i,j,k,x,y;
+         int i,j;
          STBI_SIMD_ALIGN(short, data[64]);
          for (j=0; j < z->img_mcu_y; ++j) {
             for (i=0; i < z->img_mcu_x; ++i) {
                // scan an interleaved mcu... process scan_n components in order
-               for (k=0; k < z->scan_n; ++k) {
-                  int n = z->order[k];
-                  // scan out an mcu's worth of this component; that's just determined
-                  // by the basic H and V specified for the component
-                  for (y=0; y < z->img_comp[n].v; ++y) {
-                     for (x=0; x < z->img_comp[n].h; ++x) {
-                        int x2 = (i*z->img_comp[n].h + x)*8;
-                        int y2 = (j*z->img_comp[n].v + y)*8;
-                        int ha = z->img_comp[n].ha;
-                        if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
-                     }
-                  }
-               }
+               if (!stbi__jpeg_decode_mcu(z, i, j, data)) return 0;
                // after all interleaved components, that's an interleaved MCU,
                // so now count down the restart interval
                if (--z->todo <= 0) {
@@ -3076,22 +3447,31 @@ static void stbi__jpeg_dequantize(short *data, stbi__uint16 *dequant)
       data[i] *= dequant[i];
 }
 
+// dequantize and idct one MCU row of every component
+static void stbi__jpeg_finish_row(void *task, int row)
+{
+   stbi__jpeg *z = (stbi__jpeg *) task;
+   int i,j,n;
+   for (n=0; n < z->s->img_n; ++n) {
+      int w = (z->img_comp[n].x+7) >> 3;
+      int h = (z->img_comp[n].y+7) >> 3;
+      int v = z->s->img_n == 1 ? 1 : z->img_comp[n].v;
+      for (j=row*v; j < (row+1)*v && j < h; ++j) {
+         for (i=0; i < w; ++i) {
+            short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
+            stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
+            stbi__jpeg_idct(z, n, i, j, data);
+         }
+      }
+   }
+}
+
 static void stbi__jpeg_finish(stbi__jpeg *z)
 {
    if (z->progressive) {
-      // dequantize and idct the data
-      int i,j,n;
-      for (n=0; n < z->s->img_n; ++n) {
-         int w = (z->img_comp[n].x+7) >> 3;
-         int h = (z->img_comp[n].y+7) >> 3;
-         for (j=0; j < h; ++j) {
-            for (i=0; i < w; ++i) {
-               short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
-               stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
-            }
-         }
-      }
+      // MCU rows are independent, so they can go to other threads
+      int rows = z->s->img_n == 1 ? (z->img_comp[0].y+7) >> 3 : z->img_mcu_y;
+      stbi__run_jobs(stbi__jpeg_finish_row, z, rows);
    }
 }
 
@@ -3260,6 +3640,33 @@ static int stbi__free_jpeg_components(stbi__jpeg *z, int ncomp, int why)
    return why;
 }
 
+static int stbi__jpeg_scale_shift(stbi__context *s)
+{
+   int shift = 0;
+#ifdef STBI_THREAD_LOCAL
+   if (stbi__jpeg_max_x > 0 && stbi__jpeg_max_y > 0)
+      while (shift < 3 && ((int) ((s->img_x + (1u << shift) - 1) >> shift) > stbi__jpeg_max_x ||
+                           (int) ((s->img_y + (1u << shift) - 1) >> shift) > stbi__jpeg_max_y))
+         ++shift;
+#else
+   STBI_NOTUSED(s);
+#endif
+   return shift;
+}
+
+// once all blocks are decoded, switch the image and component sizes over
+// to the reduced ones for resampling and color conversion
+static void stbi__jpeg_apply_scale(stbi__jpeg *z)
+{
+   int i, shift = z->scale_shift, round = (1 << shift) - 1;
+   z->s->img_x = (z->s->img_x + round) >> shift;
+   z->s->img_y = (z->s->img_y + round) >> shift;
+   for (i=0; i < z->s->img_n; ++i) {
+      z->img_comp[i].x = (z->img_comp[i].x + round) >> shift;
+      z->img_comp[i].y = (z->img_comp[i].y + round) >> shift;
+   }
+}
+
 static int stbi__process_frame_header(stbi__jpeg *z, int scan)
 {
    stbi__context *s = z->s;
@@ -3292,6 +3699,7 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       z->img_comp[i].tq = stbi__get8(s);  if (z->img_comp[i].tq > 3) return stbi__err("bad TQ","Corrupt JPEG");
    }
 
+   z->scale_shift = stbi__jpeg_scale_shift(s);
    if (scan != STBI__SCAN_load) return 1;
 
    if (!stbi__mad3sizes_valid(s->img_x, s->img_y, s->img_n, 0)) return stbi__err("too large", "Image too large to decode");
@@ -3333,16 +3741,21 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       z->img_comp[i].coeff = 0;
       z->img_comp[i].raw_coeff = 0;
       z->img_comp[i].linebuf = NULL;
+      if (z->progressive) {
+         // w2, h2 are multiples of 8 (see above)
+         z->img_comp[i].coeff_w = z->img_comp[i].w2 / 8;
+         z->img_comp[i].coeff_h = z->img_comp[i].h2 / 8;
+      }
+      // reduced decoding only needs reduced planes; blocks stay full-size
+      z->img_comp[i].w2 >>= z->scale_shift;
+      z->img_comp[i].h2 >>= z->scale_shift;
       z->img_comp[i].raw_data = stbi__malloc_mad2(z->img_comp[i].w2, z->img_comp[i].h2, 15);
       if (z->img_comp[i].raw_data == NULL)
          return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
       // align blocks for idct using mmx/sse
       z->img_comp[i].data = (stbi_uc*) (((size_t) z->img_comp[i].raw_data + 15) & ~15);
       if (z->progressive) {
-         // w2, h2 are multiples of 8 (see above)
-         z->img_comp[i].coeff_w = z->img_comp[i].w2 / 8;
-         z->img_comp[i].coeff_h = z->img_comp[i].h2 / 8;
-         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].w2, z->img_comp[i].h2, sizeof(short), 15);
+         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].coeff_w * 8, z->img_comp[i].coeff_h * 8, sizeof(short), 15);
          if (z->img_comp[i].raw_coeff == NULL)
             return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
          z->img_comp[i].coeff = (short*) (((size_t) z->img_comp[i].raw_coeff + 15) & ~15);
@@ -3676,7 +4089,7 @@ static void stbi__YCbCr_to_RGB_row(stbi_uc *out, const stbi_uc *y, const stbi_uc
       out[0] = (stbi_uc)r;
       out[1] = (stbi_uc)g;
       out[2] = (stbi_uc)b;
-      out[3] = 255;
+      if (step == 4) out[3] = 255; // with step 3 this would be the next pixel, maybe in another band
       out += step;
    }
 }
@@ -3810,12 +4223,125 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
       out[0] = (stbi_uc)r;
       out[1] = (stbi_uc)g;
       out[2] = (stbi_uc)b;
-      out[3] = 255;
+      if (step == 4) out[3] = 255;
       out += step;
    }
 }
 #endif
 
+#ifdef STBI_AVX2
+// same arithmetic as the sse2 versions, 16 pixels per iteration
+STBI__AVX2_TARGET
+static stbi_uc *stbi__resample_row_hv_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+   int i=0,t0,t1;
+
+   if (w == 1) {
+      out[0] = out[1] = stbi__div4(3*in_near[0] + in_far[0] + 2);
+      return out;
+   }
+
+   t1 = 3*in_near[0] + in_far[0];
+   for (; i < ((w-1) & ~15); i += 16) {
+      __m256i farw  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+      __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+      __m256i curr  = _mm256_add_epi16(_mm256_slli_epi16(nearw, 2), _mm256_sub_epi16(farw, nearw));
+
+      // shifts by one pixel have to cross the 128-bit lanes: alignr
+      // against a copy of curr with its lanes moved over by one
+      __m256i prv0 = _mm256_alignr_epi8(curr, _mm256_permute2x128_si256(curr, curr, 0x08), 14);
+      __m256i nxt0 = _mm256_alignr_epi8(_mm256_permute2x128_si256(curr, curr, 0x81), curr, 2);
+      __m256i prev = _mm256_insert_epi16(prv0, t1, 0);
+      __m256i next = _mm256_insert_epi16(nxt0, 3*in_near[i+16] + in_far[i+16], 15);
+
+      __m256i bias = _mm256_set1_epi16(8);
+      __m256i curb = _mm256_add_epi16(_mm256_slli_epi16(curr, 2), bias);
+      __m256i even = _mm256_add_epi16(_mm256_sub_epi16(prev, curr), curb);
+      __m256i odd  = _mm256_add_epi16(_mm256_sub_epi16(next, curr), curb);
+
+      // in-lane interleave and pack keep the output in order
+      __m256i de0  = _mm256_srli_epi16(_mm256_unpacklo_epi16(even, odd), 4);
+      __m256i de1  = _mm256_srli_epi16(_mm256_unpackhi_epi16(even, odd), 4);
+      _mm256_storeu_si256((__m256i *) (out + i*2), _mm256_packus_epi16(de0, de1));
+
+      t1 = 3*in_near[i+15] + in_far[i+15];
+   }
+
+   t0 = t1;
+   t1 = 3*in_near[i] + in_far[i];
+   out[i*2] = stbi__div16(3*t1 + t0 + 8);
+
+   for (++i; i < w; ++i) {
+      t0 = t1;
+      t1 = 3*in_near[i]+in_far[i];
+      out[i*2-1] = stbi__div16(3*t0 + t1 + 8);
+      out[i*2  ] = stbi__div16(3*t1 + t0 + 8);
+   }
+   out[w*2-1] = stbi__div4(t1+2);
+
+   STBI_NOTUSED(hs);
+
+   return out;
+}
+
+STBI__AVX2_TARGET
+static void stbi__YCbCr_to_RGB_avx2(stbi_uc *out, stbi_uc const *y, stbi_uc const *pcb, stbi_uc const *pcr, int count, int step)
+{
+   int i = 0;
+
+   if (step == 4) {
+      __m256i signflip  = _mm256_set1_epi16(0x80);
+      __m256i cr_const0 = _mm256_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
+      __m256i cr_const1 = _mm256_set1_epi16( - (short) ( 0.71414f*4096.0f+0.5f));
+      __m256i cb_const0 = _mm256_set1_epi16( - (short) ( 0.34414f*4096.0f+0.5f));
+      __m256i cb_const1 = _mm256_set1_epi16(   (short) ( 1.77200f*4096.0f+0.5f));
+      __m256i y_bias = _mm256_set1_epi16(128);
+      __m256i xw = _mm256_set1_epi16(255); // alpha channel
+
+      for (; i+15 < count; i += 16) {
+         // widen to short: y*256 + 128, (c-128)*256
+         __m256i yw  = _mm256_or_si256(_mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (y+i))), 8), y_bias);
+         __m256i crw = _mm256_slli_epi16(_mm256_xor_si256(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (pcr+i))), signflip), 8);
+         __m256i cbw = _mm256_slli_epi16(_mm256_xor_si256(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (pcb+i))), signflip), 8);
+
+         // color transform
+         __m256i yws = _mm256_srli_epi16(yw, 4);
+         __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+         __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+         __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+         __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+         __m256i rws = _mm256_add_epi16(cr0, yws);
+         __m256i gwt = _mm256_add_epi16(cb0, yws);
+         __m256i bws = _mm256_add_epi16(yws, cb1);
+         __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+         // descale
+         __m256i rw = _mm256_srai_epi16(rws, 4);
+         __m256i bw = _mm256_srai_epi16(bws, 4);
+         __m256i gw = _mm256_srai_epi16(gws, 4);
+
+         // back to byte and interleave; each 128-bit lane ends up with
+         // pixels 0-3 + 8-11 and 4-7 + 12-15, reordered on store
+         __m256i brb = _mm256_packus_epi16(rw, bw);
+         __m256i gxb = _mm256_packus_epi16(gw, xw);
+         __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+         __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+         __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+         __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+         _mm256_storeu_si256((__m256i *) (out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+         _mm256_storeu_si256((__m256i *) (out + 32), _mm256_permute2x128_si256(o0, o1, 0x31));
+         out += 64;
+      }
+   }
+
+   // the rest goes through the sse2 version, which rounds the scalar
+   // tail the same way as before
+   if (i < count)
+      stbi__YCbCr_to_RGB_simd(out, y+i, pcb+i, pcr+i, count-i, step);
+}
+#endif // STBI_AVX2
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
@@ -3824,17 +4350,27 @@ static void stbi__setup_jpeg(stbi__jpeg *j)
    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
 
 #ifdef STBI_SSE2
-   if (stbi__sse2_available()) {
+   if (stbi__jpeg_simd >= 1 && stbi__sse2_available()) {
       j->idct_block_kernel = stbi__idct_simd;
       j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
       j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
    }
 #endif
 
+#ifdef STBI_AVX2
+   if (stbi__jpeg_simd >= 2 && stbi__avx2_available()) {
+      j->idct_block_kernel = stbi__idct_avx2;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+   }
+#endif
+
 #ifdef STBI_NEON
-   j->idct_block_kernel = stbi__idct_simd;
-   j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
-   j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+   if (stbi__jpeg_simd >= 1) {
+      j->idct_block_kernel = stbi__idct_simd;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+   }
 #endif
 }
 
@@ -3861,6 +4397,144 @@ static stbi_uc stbi__blinn_8x8(stbi_uc x, stbi_uc y)
    return (stbi_uc) ((t + (t >>8)) >> 8);
 }
 
+typedef struct
+{
+   stbi__jpeg *z;
+   stbi__resample res_comp[4]; // state at row 0
+   stbi_uc *output;
+   int out_stride, n, decode_n, is_rgb, swap_rb;
+   int rows; // per job
+} stbi__jpeg_convert_task;
+
+// advance the vertical resampling state of component k by one output row
+static void stbi__resample_next_row(stbi__jpeg *z, stbi__resample *r, int k)
+{
+   if (++r->ystep >= r->vs) {
+      r->ystep = 0;
+      r->line0 = r->line1;
+      if (++r->ypos < z->img_comp[k].y)
+         r->line1 += z->img_comp[k].w2;
+   }
+}
+
+// resample and color-convert a band of output rows. each band gets its own
+// copy of the resampling state and its own line buffers
+static void stbi__jpeg_convert_rows(void *task, int band)
+{
+   stbi__jpeg_convert_task *t = (stbi__jpeg_convert_task *) task;
+   stbi__jpeg *z = t->z;
+   stbi__resample res_comp[4];
+   stbi_uc *coutput[4] = { NULL, NULL, NULL, NULL };
+   stbi_uc *linebuf[4];
+   unsigned int i, j, j0 = band * t->rows, j1 = j0 + t->rows;
+   int k, n = t->n;
+
+   if (j1 > z->s->img_y) j1 = z->s->img_y;
+   for (k=0; k < t->decode_n; ++k) {
+      res_comp[k] = t->res_comp[k];
+      for (j=0; j < j0; ++j)
+         stbi__resample_next_row(z, &res_comp[k], k);
+      linebuf[k] = z->img_comp[k].linebuf + (size_t) band * (z->s->img_x + 3);
+   }
+
+   for (j=j0; j < j1; ++j) {
+      stbi_uc *out = t->output + (size_t) t->out_stride * j;
+      for (k=0; k < t->decode_n; ++k) {
+         stbi__resample *r = &res_comp[k];
+         int y_bot = r->ystep >= (r->vs >> 1);
+         coutput[k] = r->resample(linebuf[k],
+                                  y_bot ? r->line1 : r->line0,
+                                  y_bot ? r->line0 : r->line1,
+                                  r->w_lores, r->hs);
+         stbi__resample_next_row(z, r, k);
+      }
+      if (n >= 3) {
+         stbi_uc *y = coutput[0];
+         if (z->s->img_n == 3) {
+            if (t->is_rgb) {
+               for (i=0; i < z->s->img_x; ++i) {
+                  out[0] = y[i];
+                  out[1] = coutput[1][i];
+                  out[2] = coutput[2][i];
+                  if (n == 4) out[3] = 255;
+                  out += n;
+               }
+            } else {
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+            }
+         } else if (z->s->img_n == 4) {
+            if (z->app14_color_transform == 0) { // CMYK
+               for (i=0; i < z->s->img_x; ++i) {
+                  stbi_uc m = coutput[3][i];
+                  out[0] = stbi__blinn_8x8(coutput[0][i], m);
+                  out[1] = stbi__blinn_8x8(coutput[1][i], m);
+                  out[2] = stbi__blinn_8x8(coutput[2][i], m);
+                  if (n == 4) out[3] = 255;
+                  out += n;
+               }
+            } else if (z->app14_color_transform == 2) { // YCCK
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+               for (i=0; i < z->s->img_x; ++i) {
+                  stbi_uc m = coutput[3][i];
+                  out[0] = stbi__blinn_8x8(255 - out[0], m);
+                  out[1] = stbi__blinn_8x8(255 - out[1], m);
+                  out[2] = stbi__blinn_8x8(255 - out[2], m);
+                  out += n;
+               }
+            } else { // YCbCr + alpha?  Ignore the fourth channel for now
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+            }
+         } else
+            for (i=0; i < z->s->img_x; ++i) {
+               out[0] = out[1] = out[2] = y[i];
+               if (n == 4) out[3] = 255; // n==3 must not touch the next band's first pixel
+               out += n;
+            }
+      } else {
+         if (t->is_rgb) {
+            if (n == 1)
+               for (i=0; i < z->s->img_x; ++i)
+                  *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+            else {
+               for (i=0; i < z->s->img_x; ++i, out += 2) {
+                  out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+                  out[1] = 255;
+               }
+            }
+         } else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
+            for (i=0; i < z->s->img_x; ++i) {
+               stbi_uc m = coutput[3][i];
+               stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
+               stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
+               stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
+               out[0] = stbi__compute_y(r, g, b);
+               out[1] = 255;
+               out += n;
+            }
+         } else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
+            for (i=0; i < z->s->img_x; ++i) {
+               out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
+               out[1] = 255;
+               out += n;
+            }
+         } else {
+            stbi_uc *y = coutput[0];
+            if (n == 1)
+               for (i=0; i < z->s->img_x; ++i) out[i] = y[i];
+            else
+               for (i=0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
+         }
+      }
+      if (t->swap_rb) {
+         // the row is still in cache, so swizzling here is nearly free
+         stbi_uc *p = t->output + (size_t) t->out_stride * j;
+         for (i=0; i < z->s->img_x; ++i, p += n) {
+            stbi_uc c = p[0]; p[0] = p[2]; p[2] = c;
+         }
+      }
+   }
+}
+
 static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
 {
    int n, decode_n, is_rgb;
@@ -3871,6 +4545,7 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
 
    // load a jpeg image from whichever source, but leave in YCbCr format
    if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
+   if (z->scale_shift) stbi__jpeg_apply_scale(z);
 
    // determine actual number of components to generate
    n = req_comp ? req_comp : z->s->img_n >= 3 ? 3 : 1;
@@ -3888,19 +4563,23 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
 
    // resample and color-convert
    {
-      int k;
-      unsigned int i,j;
-      stbi_uc *output;
-      stbi_uc *coutput[4] = { NULL, NULL, NULL, NULL };
+      int k, bands;
+      stbi_uc *output = NULL;
+      int out_stride = n * z->s->img_x, swap_rb = 0;
 
-      stbi__resample res_comp[4];
+      stbi__jpeg_convert_task task;
+      stbi__resample *res_comp = task.res_comp;
+
+      // bands of rows for the thread pool, or the whole image at once
+      task.rows = stbi__parallel ? 32 : z->s->img_y;
+      bands = (z->s->img_y + task.rows - 1) / task.rows;
 
       for (k=0; k < decode_n; ++k) {
          stbi__resample *r = &res_comp[k];
 
-         // allocate line buffer big enough for upsampling off the edges
-         // with upsample factor of 4
-         z->img_comp[k].linebuf = (stbi_uc *) stbi__malloc(z->s->img_x + 3);
+         // allocate line buffers big enough for upsampling off the edges
+         // with upsample factor of 4, one per band
+         z->img_comp[k].linebuf = (stbi_uc *) stbi__malloc_mad2(bands, z->s->img_x + 3, 0);
          if (!z->img_comp[k].linebuf) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
 
          r->hs      = z->img_h_max / z->img_comp[k].h;
@@ -3918,104 +4597,25 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
       }
 
       // can't error after this so, this is safe
-      output = (stbi_uc *) stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
+      #ifdef STBI_THREAD_LOCAL
+      if (stbi__dest_func && !stbi__vertically_flip_on_load) {
+         output = stbi__dest_func(stbi__dest_user, z->s->img_x, z->s->img_y, n, &out_stride);
+         if (output) swap_rb = stbi__dest_swap_rb && n >= 3;
+         else out_stride = n * z->s->img_x;
+      }
+      #endif
+      if (!output) output = (stbi_uc *) stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
       if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
 
       // now go ahead and resample
-      for (j=0; j < z->s->img_y; ++j) {
-         stbi_uc *out = output + n * z->s->img_x * j;
-         for (k=0; k < decode_n; ++k) {
-            stbi__resample *r = &res_comp[k];
-            int y_bot = r->ystep >= (r->vs >> 1);
-            coutput[k] = r->resample(z->img_comp[k].linebuf,
-                                     y_bot ? r->line1 : r->line0,
-                                     y_bot ? r->line0 : r->line1,
-                                     r->w_lores, r->hs);
-            if (++r->ystep >= r->vs) {
-               r->ystep = 0;
-               r->line0 = r->line1;
-               if (++r->ypos < z->img_comp[k].y)
-                  r->line1 += z->img_comp[k].w2;
-            }
-         }
-         if (n >= 3) {
-            stbi_uc *y = coutput[0];
-            if (z->s->img_n == 3) {
-               if (is_rgb) {
-                  for (i=0; i < z->s->img_x; ++i) {
-                     out[0] = y[i];
-                     out[1] = coutput[1][i];
-                     out[2] = coutput[2][i];
-                     out[3] = 255;
-                     out += n;
-                  }
-               } else {
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-               }
-            } else if (z->s->img_n == 4) {
-               if (z->app14_color_transform == 0) { // CMYK
-                  for (i=0; i < z->s->img_x; ++i) {
-                     stbi_uc m = coutput[3][i];
-                     out[0] = stbi__blinn_8x8(coutput[0][i], m);
-                     out[1] = stbi__blinn_8x8(coutput[1][i], m);
-                     out[2] = stbi__blinn_8x8(coutput[2][i], m);
-                     out[3] = 255;
-                     out += n;
-                  }
-               } else if (z->app14_color_transform == 2) { // YCCK
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                  for (i=0; i < z->s->img_x; ++i) {
-                     stbi_uc m = coutput[3][i];
-                     out[0] = stbi__blinn_8x8(255 - out[0], m);
-                     out[1] = stbi__blinn_8x8(255 - out[1], m);
-                     out[2] = stbi__blinn_8x8(255 - out[2], m);
-                     out += n;
-                  }
-               } else { // YCbCr + alpha?  Ignore the fourth channel for now
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-               }
-            } else
-               for (i=0; i < z->s->img_x; ++i) {
-                  out[0] = out[1] = out[2] = y[i];
-                  out[3] = 255; // not used if n==3
-                  out += n;
-               }
-         } else {
-            if (is_rgb) {
-               if (n == 1)
-                  for (i=0; i < z->s->img_x; ++i)
-                     *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-               else {
-                  for (i=0; i < z->s->img_x; ++i, out += 2) {
-                     out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-                     out[1] = 255;
-                  }
-               }
-            } else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
-               for (i=0; i < z->s->img_x; ++i) {
-                  stbi_uc m = coutput[3][i];
-                  stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
-                  stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
-                  stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
-                  out[0] = stbi__compute_y(r, g, b);
-                  out[1] = 255;
-                  out += n;
-               }
-            } else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
-               for (i=0; i < z->s->img_x; ++i) {
-                  out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
-                  out[1] = 255;
-                  out += n;
-               }
-            } else {
-               stbi_uc *y = coutput[0];
-               if (n == 1)
-                  for (i=0; i < z->s->img_x; ++i) out[i] = y[i];
-               else
-                  for (i=0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
-            }
-         }
-      }
+      task.z = z;
+      task.output = output;
+      task.out_stride = out_stride;
+      task.n = n;
+      task.decode_n = decode_n;
+      task.is_rgb = is_rgb;
+      task.swap_rb = swap_rb;
+      stbi__run_jobs(stbi__jpeg_convert_rows, &task, bands);
       stbi__cleanup_jpeg(z);
       *out_x = z->s->img_x;
       *out_y = z->s->img_y;
@@ -4058,8 +4658,8 @@ static int stbi__jpeg_info_raw(stbi__jpeg *j, int *x, int *y, int *comp)
       stbi__rewind( j->s );
       return 0;
    }
-   if (x) *x = j->s->img_x;
-   if (y) *y = j->s->img_y;
+   if (x) *x = (j->s->img_x + (1 << j->scale_shift) - 1) >> j->scale_shift;
+   if (y) *y = (j->s->img_y + (1 << j->scale_shift) - 1) >> j->scale_shift;
    if (comp) *comp = j->s->img_n >= 3 ? 3 : 1;
    return 1;
 }
@@ -4090,6 +4690,8 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 #define STBI__ZFAST_BITS  9 // accelerate all cases in default tables
 #define STBI__ZFAST_MASK  ((1 << STBI__ZFAST_BITS) - 1)
 #define STBI__ZNSYMS 288 // number of symbols in literal/length alphabet
+#define STBI__ZPAIR_BITS  11 // glfw-experiments: literal pair table, see stbi__zbuild_pairs
+#define STBI__ZPAIR_MASK  ((1 << STBI__ZPAIR_BITS) - 1)
 
 // zlib-style huffman encoding
 // (jpegs packs from left, zlib from right, so can't share code)
@@ -4186,6 +4788,7 @@ typedef struct
    int   z_expandable;
 
    stbi__zhuffman z_length, z_distance;
+   stbi__uint32 z_pair[1 << STBI__ZPAIR_BITS];
 } stbi__zbuf;
 
 stbi_inline static int stbi__zeof(stbi__zbuf *z)
@@ -4291,6 +4894,28 @@ static int stbi__zexpand(stbi__zbuf *z, char *zout, int n)  // need to make room
    return 1;
 }
 
+// glfw-experiments: filtered image data is mostly literals with short codes,
+// so besides the 9-bit fast table we keep an 11-bit table that resolves one
+// or two literals per lookup. entry: bits used << 24 | count << 16 |
+// second << 8 | first; 0 if the code doesn't start with a fast literal.
+static void stbi__zbuild_pairs(stbi__zbuf *a)
+{
+   int i;
+   for (i=0; i < (1 << STBI__ZPAIR_BITS); ++i) {
+      int f1 = a->z_length.fast[i & STBI__ZFAST_MASK], f2, s1, s2;
+      a->z_pair[i] = 0;
+      if (!f1 || (f1 & 511) >= 256) continue;
+      s1 = f1 >> 9;
+      a->z_pair[i] = (stbi__uint32) (s1 << 24 | 1 << 16 | (f1 & 511));
+      // the second code only sees the bits left after the first, so it's
+      // known only if it fits in them
+      f2 = a->z_length.fast[(i >> s1) & STBI__ZFAST_MASK];
+      s2 = f2 >> 9;
+      if (f2 && (f2 & 511) < 256 && s1 + s2 <= STBI__ZPAIR_BITS)
+         a->z_pair[i] = (stbi__uint32) ((s1 + s2) << 24 | 2 << 16 | (f2 & 511) << 8 | (f1 & 511));
+   }
+}
+
 static const int stbi__zlength_base[31] = {
    3,4,5,6,7,8,9,10,11,13,
    15,17,19,23,27,31,35,43,51,59,
@@ -4305,11 +4930,138 @@ static const int stbi__zdist_base[32] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129
 static const int stbi__zdist_extra[32] =
 { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
 
+// glfw-experiments: fast inner loop of the inflater, run while there are at
+// least 8 bytes of input left and room for a whole match in the output. The
+// bit buffer is 64-bit and refilled with one 8-byte read per step, enough
+// for a full length/distance pair; literals come one or two per lookup from
+// z_pair, and matches are copied 8 bytes at a time. Anything unusual (bad
+// codes or distances) rewinds to the start of the symbol and leaves it to
+// the careful loop below, which reports the error as before.
+typedef unsigned long long stbi__zbits;
+
+#define STBI__ZFAST_MARGIN (258 + 8) // longest match plus copy overshoot
+
+stbi_inline static int stbi__zfast_ready(stbi__zbuf *a, char *zout)
+{
+   return a->zbuffer_end - a->zbuffer >= 8 && a->zout_end - zout >= STBI__ZFAST_MARGIN;
+}
+
+stbi_inline static stbi__zbits stbi__zload64(const stbi_uc *p)
+{
+   // byte order independent; compilers turn this into a single load
+   return (stbi__zbits) p[0]       | (stbi__zbits) p[1] <<  8 | (stbi__zbits) p[2] << 16 | (stbi__zbits) p[3] << 24
+        | (stbi__zbits) p[4] << 32 | (stbi__zbits) p[5] << 40 | (stbi__zbits) p[6] << 48 | (stbi__zbits) p[7] << 56;
+}
+
+// like stbi__zhuffman_decode, on the local bit buffer; -1 on a bad code
+stbi_inline static int stbi__zfast_decode(stbi__zbits *bits, int *nbits, stbi__zhuffman *z)
+{
+   int b = z->fast[*bits & STBI__ZFAST_MASK], s, k;
+   if (b) {
+      s = b >> 9;
+   } else {
+      k = stbi__bit_reverse((int) (*bits & 0xffff), 16);
+      for (s=STBI__ZFAST_BITS+1; s < 16; ++s)
+         if (k < z->maxcode[s])
+            break;
+      if (s >= 16) return -1;
+      b = (k >> (16-s)) - z->firstcode[s] + z->firstsymbol[s];
+      if (b >= STBI__ZNSYMS || z->size[b] != s) return -1;
+      b = z->value[b];
+   }
+   *bits >>= s;
+   *nbits -= s;
+   return b & 511;
+}
+
+// returns 1 after the end-of-block code
+static int stbi__zfast_loop(stbi__zbuf *a, char **pzout)
+{
+   stbi__zbits bits = a->code_buffer;
+   int nbits = a->num_bits, end = 0;
+   stbi_uc *in = a->zbuffer;
+   char *zout = *pzout;
+
+   while (a->zbuffer_end - in >= 8 && a->zout_end - zout >= STBI__ZFAST_MARGIN) {
+      stbi__zbits start_bits;
+      stbi_uc *start_in;
+      int start_nbits, z, len, dist, e;
+      stbi__uint32 pair;
+
+      bits |= stbi__zload64(in) << nbits;
+      in += (63 - nbits) >> 3;
+      nbits |= 56;
+      start_bits = bits; start_nbits = nbits; start_in = in;
+
+      pair = a->z_pair[bits & STBI__ZPAIR_MASK];
+      if (pair) {
+         bits >>= pair >> 24;
+         nbits -= pair >> 24;
+         *zout++ = (char) pair;
+         if (pair & (2 << 16)) *zout++ = (char) (pair >> 8);
+         continue;
+      }
+      z = stbi__zfast_decode(&bits, &nbits, &a->z_length);
+      if (z < 256) {
+         if (z < 0) goto rewind;
+         *zout++ = (char) z;
+         continue;
+      }
+      if (z == 256) { end = 1; break; }
+      if (z >= 286) goto rewind;
+      z -= 257;
+      len = stbi__zlength_base[z];
+      e = stbi__zlength_extra[z];
+      len += (int) (bits & ((1 << e) - 1));
+      bits >>= e; nbits -= e;
+      z = stbi__zfast_decode(&bits, &nbits, &a->z_distance);
+      if (z < 0 || z >= 30) goto rewind;
+      dist = stbi__zdist_base[z];
+      e = stbi__zdist_extra[z];
+      dist += (int) (bits & ((1 << e) - 1));
+      bits >>= e; nbits -= e;
+      if (zout - a->zout_start < dist) goto rewind;
+      {
+         char *p = zout - dist, *q = zout;
+         zout += len;
+         if (dist >= 8) {
+            // the source is always at least a chunk behind
+            do { memcpy(q, p, 8); q += 8; p += 8; } while (q < zout);
+         } else if (dist == 1) {
+            memset(q, *p, len);
+         } else {
+            do *q++ = *p++; while (q < zout);
+         }
+      }
+      continue;
+   rewind:
+      bits = start_bits; nbits = start_nbits; in = start_in;
+      break;
+   }
+
+   // give back the whole bytes still in the bit buffer
+   in -= nbits >> 3;
+   nbits &= 7;
+   a->code_buffer = (stbi__uint32) (bits & ((1u << nbits) - 1));
+   a->num_bits = nbits;
+   a->zbuffer = in;
+   *pzout = zout;
+   return end;
+}
+
 static int stbi__parse_huffman_block(stbi__zbuf *a)
 {
    char *zout = a->zout;
    for(;;) {
-      int z = stbi__zhuffman_decode(a, &a->z_length);
+      int z;
+      if (stbi__zfast_ready(a, zout)) {
+         int end = stbi__zfast_loop(a, &zout);
+         if (end) {
+            a->zout = zout;
+            return 1;
+         }
+      }
+      z = stbi__zhuffman_decode(a, &a->z_length);
       if (z < 256) {
          if (z < 0) return stbi__err("bad huffman code","Corrupt PNG"); // error in huffman codes
          if (zout >= a->zout_end) {
@@ -4500,6 +5252,7 @@ static int stbi__parse_zlib(stbi__zbuf *a, int parse_header)
          } else {
             if (!stbi__compute_huffman_codes(a)) return 0;
          }
+         stbi__zbuild_pairs(a);
          if (!stbi__parse_huffman_block(a)) return 0;
       }
    } while (!final);
@@ -4641,7 +5394,9 @@ enum {
    STBI__F_avg=3,
    STBI__F_paeth=4,
    // synthetic filter used for first scanline to avoid needing a dummy row of 0s
-   STBI__F_avg_first
+   STBI__F_avg_first,
+   // row already unfiltered by stbi__png_unfilter_fast
+   STBI__F_done
 };
 
 static stbi_uc first_row_filter[5] =
@@ -4691,6 +5446,115 @@ static void stbi__create_png_alpha_expand8(stbi_uc *dest, stbi_uc *src, stbi__ui
    }
 }
 
+#ifdef STBI_SSE2
+// glfw-experiments: sse2 unfiltering of 8-bit rows with 3 or 4 bytes per
+// pixel (RGB, RGBA). Up is plain 16-byte adds. Sub, Avg and Paeth depend on
+// the pixel to the left, so they step one whole pixel at a time in 16-bit
+// lanes, except Sub on RGBA, which is a prefix sum over 4 pixels. Pixels
+// are moved as 4 bytes (for RGB the 4th lane is junk that the next pixel
+// overwrites), so the last RGB pixel is done by the scalar tail. Results
+// are identical to the scalar loops.
+static __m128i stbi__png_load_px(const stbi_uc *p)
+{
+   stbi__uint32 v;
+   memcpy(&v, p, 4);
+   return _mm_unpacklo_epi8(_mm_cvtsi32_si128((int) v), _mm_setzero_si128());
+}
+
+static void stbi__png_store_px(stbi_uc *p, __m128i v)
+{
+   stbi__uint32 t = (stbi__uint32) _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+   memcpy(p, &t, 4);
+}
+
+// returns 0 if the row is left to the scalar code
+static int stbi__png_unfilter_simd(int filter, stbi_uc *cur, const stbi_uc *raw, const stbi_uc *prior, int nk, int bpp)
+{
+   __m128i zero = _mm_setzero_si128(), mask = _mm_set1_epi16(255);
+   __m128i a = zero, c = zero, b, x;
+   int k = 0;
+
+   switch (filter) {
+   case STBI__F_up:
+      for (; k+16 <= nk; k += 16)
+         _mm_storeu_si128((__m128i *) (cur+k), _mm_add_epi8(_mm_loadu_si128((const __m128i *) (raw+k)),
+                                                            _mm_loadu_si128((const __m128i *) (prior+k))));
+      for (; k < nk; ++k)
+         cur[k] = STBI__BYTECAST(raw[k] + prior[k]);
+      return 1;
+   case STBI__F_sub:
+      if (bpp == 4) {
+         __m128i last = zero;
+         for (; k+16 <= nk; k += 16) {
+            x = _mm_loadu_si128((const __m128i *) (raw+k));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi8(x, last);
+            _mm_storeu_si128((__m128i *) (cur+k), x);
+            last = _mm_shuffle_epi32(x, 0xff);
+         }
+         a = _mm_unpacklo_epi8(last, zero);
+      }
+      for (; k+4 <= nk; k += bpp) {
+         a = _mm_and_si128(_mm_add_epi16(stbi__png_load_px(raw+k), a), mask);
+         stbi__png_store_px(cur+k, a);
+      }
+      break;
+   case STBI__F_avg:
+      for (; k+4 <= nk; k += bpp) {
+         b = stbi__png_load_px(prior+k);
+         x = _mm_srli_epi16(_mm_add_epi16(a, b), 1);
+         a = _mm_and_si128(_mm_add_epi16(stbi__png_load_px(raw+k), x), mask);
+         stbi__png_store_px(cur+k, a);
+      }
+      break;
+   case STBI__F_paeth:
+      // the branch-free formulation of stbi__paeth; the first pixel has
+      // a = c = 0 and so gets b, like the scalar code
+      for (; k+4 <= nk; k += bpp) {
+         __m128i thresh, lo, hi, t0, m;
+         b = stbi__png_load_px(prior+k);
+         thresh = _mm_sub_epi16(_mm_sub_epi16(_mm_add_epi16(c, _mm_add_epi16(c, c)), b), a);
+         lo = _mm_min_epi16(a, b);
+         hi = _mm_max_epi16(a, b);
+         m = _mm_cmpgt_epi16(hi, thresh);
+         t0 = _mm_or_si128(_mm_and_si128(m, c), _mm_andnot_si128(m, lo));
+         m = _mm_cmpgt_epi16(thresh, lo);
+         x = _mm_or_si128(_mm_and_si128(m, t0), _mm_andnot_si128(m, hi));
+         a = _mm_and_si128(_mm_add_epi16(stbi__png_load_px(raw+k), x), mask);
+         stbi__png_store_px(cur+k, a);
+         c = b;
+      }
+      break;
+   default:
+      return 0;
+   }
+
+   // scalar tail: the last RGB pixel, or a row of a single one
+   for (; k < nk; ++k) {
+      int left = k >= bpp ? cur[k-bpp] : 0, upleft = k >= bpp ? prior[k-bpp] : 0;
+      if (filter == STBI__F_sub)
+         cur[k] = STBI__BYTECAST(raw[k] + left);
+      else if (filter == STBI__F_avg)
+         cur[k] = STBI__BYTECAST(raw[k] + ((prior[k] + left) >> 1));
+      else
+         cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(left, prior[k], upleft));
+   }
+   return 1;
+}
+#endif
+
+static int stbi__png_unfilter_fast(int filter, stbi_uc *cur, const stbi_uc *raw, const stbi_uc *prior, int nk, int bpp, int depth)
+{
+#ifdef STBI_SSE2
+   if (depth == 8 && (bpp == 3 || bpp == 4) && stbi__sse2_available())
+      return stbi__png_unfilter_simd(filter, cur, raw, prior, nk, bpp);
+#endif
+   STBI_NOTUSED(filter); STBI_NOTUSED(cur); STBI_NOTUSED(raw); STBI_NOTUSED(prior);
+   STBI_NOTUSED(nk); STBI_NOTUSED(bpp); STBI_NOTUSED(depth);
+   return 0;
+}
+
 // create the png data from post-deflated data
 static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
 {
@@ -4751,6 +5615,8 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
       if (j == 0) filter = first_row_filter[filter];
 
       // perform actual filtering
+      if (stbi__png_unfilter_fast(filter, cur, raw, prior, nk, filter_bytes, depth))
+         filter = STBI__F_done;
       switch (filter) {
       case STBI__F_none:
          memcpy(cur, raw, nk);
@@ -0,0 +1,268 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pixfmt.h"
+#include "remote.h"
+#include "store.h"
+
+struct StoreManager {
+  Compositor *comp;
+  size_t budget;
+  int idle;
+  StoreRedraw *redraw;
+  void *ctx;
+  uint64_t tick;
+  RemoteConn *unpacker; // Буферы распаковки (главный поток)
+  // Очередь на сжатие; всё ниже - под lock
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake, done;
+  Viewer **queue;
+  int queueCount, queueCap;
+  int quit;
+  StoreStats stats;
+};
+
+static double now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *pack_thread(void *arg) {
+  StoreManager *m = arg;
+  RemoteConn *packer = remote_buffer();
+  unsigned char *packed;
+  size_t size, raw;
+  Viewer *v;
+
+  pthread_mutex_lock(&m->lock);
+  for (;;) {
+    while (!m->queueCount && !m->quit) pthread_cond_wait(&m->wake, &m->lock);
+    if (m->quit) break;
+    v = m->queue[0];
+    memmove(m->queue, m->queue + 1, --m->queueCount * sizeof(Viewer *));
+    v->store = STORE_PACKING;
+    pthread_mutex_unlock(&m->lock);
+
+    // Пока вьюер сжимается, главный поток его не трогает (store_load ждёт)
+    raw = (size_t)v->width * v->height * 4;
+    packed = packer ? remote_pack(packer, v->pixels, v->stride, v->width, v->height, &size) : NULL;
+
+    pthread_mutex_lock(&m->lock);
+    if (packed && size < raw) {
+      pix_free(v->pixels);
+      v->pixels = NULL;
+      v->packed = packed;
+      v->packedSize = size;
+      v->store = STORE_PACKED;
+      m->stats.packs++;
+    } else {
+      // Не сжимается: остаётся как есть до следующего простоя
+      free(packed);
+      v->store = STORE_RESIDENT;
+      v->used = m->tick;
+    }
+    pthread_cond_broadcast(&m->done);
+  }
+  pthread_mutex_unlock(&m->lock);
+  remote_close(packer);
+  return NULL;
+}
+
+StoreManager *store_create(Compositor *c, size_t budget, int idle, StoreRedraw *redraw, void *ctx) {
+  StoreManager *m = calloc(1, sizeof(StoreManager));
+
+  if (!m) return NULL;
+  m->comp = c;
+  m->budget = budget;
+  m->idle = idle > 0 ? idle : 1;
+  m->redraw = redraw;
+  m->ctx = ctx;
+  m->unpacker = remote_buffer();
+  pthread_mutex_init(&m->lock, NULL);
+  pthread_cond_init(&m->wake, NULL);
+  pthread_cond_init(&m->done, NULL);
+  if (!m->unpacker || pthread_create(&m->thread, NULL, pack_thread, m)) {
+    fprintf(stderr, "store: не удалось запустить поток сжатия\n");
+    remote_close(m->unpacker);
+    free(m);
+    return NULL;
+  }
+  c->stores = m;
+  return m;
+}
+
+// Снимает вьюер с очереди или ждёт конца его сжатия; под lock
+static void settle(StoreManager *m, Viewer *v) {
+  if (v->store == STORE_QUEUED) {
+    for (int i = 0; i < m->queueCount; i++) {
+      if (m->queue[i] != v) continue;
+      memmove(m->queue + i, m->queue + i + 1, (m->queueCount - i - 1) * sizeof(Viewer *));
+      m->queueCount--;
+      break;
+    }
+    v->store = STORE_RESIDENT;
+  }
+  while (v->store == STORE_PACKING) pthread_cond_wait(&m->done, &m->lock);
+}
+
+void store_destroy(StoreManager *m) {
+  if (!m) return;
+  pthread_mutex_lock(&m->lock);
+  m->quit = 1;
+  pthread_cond_signal(&m->wake);
+  pthread_mutex_unlock(&m->lock);
+  pthread_join(m->thread, NULL);
+  // Вьюеры из очереди остаются как есть
+  for (int i = 0; i < m->queueCount; i++) m->queue[i]->store = STORE_RESIDENT;
+  m->comp->stores = NULL;
+  remote_close(m->unpacker);
+  pthread_mutex_destroy(&m->lock);
+  pthread_cond_destroy(&m->wake);
+  pthread_cond_destroy(&m->done);
+  free(m->queue);
+  free(m);
+}
+
+unsigned char *store_load(StoreManager *m, Viewer *v) {
+  unsigned char *pixels;
+  double start, t;
+  int stride;
+
+  pthread_mutex_lock(&m->lock);
+  settle(m, v);
+  v->used = m->tick;
+  pthread_mutex_unlock(&m->lock);
+  // Дальше вьюер - только у главного потока
+  if (v->store == STORE_RESIDENT) {
+    m->stats.hits++;
+    return v->pixels;
+  }
+
+  pixels = pix_alloc(v->width, v->height, &stride);
+  if (!pixels) return NULL;
+  if (v->store == STORE_PACKED) {
+    start = now();
+    if (remote_unpack(m->unpacker, v->packed, v->packedSize, pixels, stride, v->width, v->height)) {
+      t = now() - start;
+      m->stats.unpacks++;
+      m->stats.unpackTime += t;
+      if (t > m->stats.unpackMax) m->stats.unpackMax = t;
+    } else {
+      // В буфере неизвестно что: как выгруженный, рисуется заново
+      fprintf(stderr, "store: повреждённое хранилище\n");
+      v->store = STORE_EVICTED;
+    }
+    free(v->packed);
+    v->packed = NULL;
+    v->packedSize = 0;
+  }
+  v->pixels = pixels;
+  v->stride = stride;
+  if (v->store == STORE_EVICTED) {
+    for (int y = 0; y < v->height; y++) {
+      uint32_t *row = (uint32_t *)(pixels + (size_t)y * stride);
+      for (int x = 0; x < v->width; x++) row[x] = m->comp->background;
+    }
+    v->store = STORE_RESIDENT;
+    m->stats.redraws++;
+    if (m->redraw) m->redraw(v, m->ctx);
+    v->damageCount = -1;
+  }
+  v->store = STORE_RESIDENT;
+  return pixels;
+}
+
+void store_forget(StoreManager *m, Viewer *v) {
+  pthread_mutex_lock(&m->lock);
+  settle(m, v);
+  pthread_mutex_unlock(&m->lock);
+}
+
+static void evict(Viewer *v) {
+  pix_free(v->pixels);
+  v->pixels = NULL;
+  free(v->packed);
+  v->packed = NULL;
+  v->packedSize = 0;
+  if (v->texture) {
+    glDeleteTextures(1, &v->texture);
+    v->texture = 0;
+  }
+  v->store = STORE_EVICTED;
+}
+
+// Размер хранилища в памяти; под lock
+static size_t store_size(const Viewer *v) {
+  if (v->store == STORE_PACKED) return v->packedSize;
+  if (v->store == STORE_EVICTED) return 0;
+  return (size_t)v->stride * v->height;
+}
+
+void store_tick(StoreManager *m) {
+  Viewer *lru;
+  size_t total = 0;
+  int packed;
+
+  pthread_mutex_lock(&m->lock);
+  m->tick++;
+  for (Viewer *v = m->comp->viewers; v; v = v->next) {
+    if (v->store == STORE_RESIDENT && v->occluded && m->tick - v->used >= (uint64_t)m->idle) {
+      if (m->queueCount == m->queueCap) {
+        Viewer **p = realloc(m->queue, (m->queueCap ? m->queueCap * 2 : 16) * sizeof(Viewer *));
+        if (!p) break;
+        m->queue = p;
+        m->queueCap = m->queueCap ? m->queueCap * 2 : 16;
+      }
+      m->queue[m->queueCount++] = v;
+      v->store = STORE_QUEUED;
+      pthread_cond_signal(&m->wake);
+    }
+    total += store_size(v);
+  }
+
+  /* Сверх бюджета: выгрузка самых давних сжатых, а если их нет - самых
+     давних невидимых несжатых */
+  while (m->redraw && total > m->budget) {
+    lru = NULL;
+    for (Viewer *v = m->comp->viewers; v; v = v->next) {
+      if (v->store == STORE_PACKED && (!lru || v->used < lru->used)) lru = v;
+    }
+    packed = lru != NULL;
+    for (Viewer *v = m->comp->viewers; v && !packed; v = v->next) {
+      if (!v->occluded || v->store == STORE_PACKING || v->store == STORE_EVICTED) continue;
+      if (!lru || v->used < lru->used) lru = v;
+    }
+    if (!lru) break;
+    total -= store_size(lru);
+    settle(m, lru);
+    evict(lru);
+    m->stats.evictions++;
+  }
+  pthread_mutex_unlock(&m->lock);
+}
+
+void store_stats(StoreManager *m, StoreStats *stats) {
+  pthread_mutex_lock(&m->lock);
+  *stats = m->stats;
+  stats->resident = stats->packed = stats->packedRaw = 0;
+  stats->residentCount = stats->packedCount = stats->evictedCount = 0;
+  for (Viewer *v = m->comp->viewers; v; v = v->next) {
+    if (v->store == STORE_PACKED) {
+      stats->packed += v->packedSize;
+      stats->packedRaw += (size_t)v->stride * v->height;
+      stats->packedCount++;
+    } else if (v->store == STORE_EVICTED) {
+      stats->evictedCount++;
+    } else {
+      stats->resident += (size_t)v->stride * v->height;
+      stats->residentCount++;
+    }
+  }
+  pthread_mutex_unlock(&m->lock);
+}
@@ -0,0 +1,52 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "compositor.h"
+
+/* Хранилища вьюеров, которые не видны (закрыты другими или вне
+   экрана). Буфер вьюера, к которому не обращались idle тактов
+   (comp_update), сжимается в фоновом потоке плитками удалённого
+   дисплея (remote.h: один цвет, палитра и RLE - для текста, LZ - для
+   остального), и несжатый буфер освобождается. При обращении
+   (viewer_pixels) буфер распаковывается.
+
+   Если хранилища вместе, сжатые и нет, больше budget байт, давно не
+   использованные невидимые вьюеры выгружаются совсем, а при обращении
+   рисуются заново функцией redraw. Без redraw хранилища только
+   сжимаются. */
+
+enum { STORE_RESIDENT, STORE_QUEUED, STORE_PACKING, STORE_PACKED, STORE_EVICTED };
+
+// Рисует весь буфер вьюера (он залит фоном), как после comp_open
+typedef void StoreRedraw(Viewer *v, void *ctx);
+
+typedef struct StoreStats {
+  size_t resident, packed; // Байт в несжатых и в сжатых хранилищах
+  size_t packedRaw; // Несжатый размер сжатых: степень сжатия - packedRaw / packed
+  int residentCount, packedCount, evictedCount;
+  uint64_t hits, unpacks, redraws; // Обращения: буфер на месте, распакован, нарисован заново
+  uint64_t packs, evictions;
+  double unpackTime, unpackMax; // Секунды: всего и самая долгая распаковка
+} StoreStats;
+
+typedef struct StoreManager StoreManager;
+
+// Подключает менеджер к компоновщику (c->stores); закрывается в comp_destroy
+StoreManager *store_create(Compositor *c, size_t budget, int idle, StoreRedraw *redraw, void *ctx);
+void store_stats(StoreManager *m, StoreStats *stats);
+
+// Для compositor.c
+
+void store_destroy(StoreManager *m);
+
+// Буфер на месте (ждёт фоновое сжатие, распаковывает или рисует заново)
+unsigned char *store_load(StoreManager *m, Viewer *v);
+// Вьюер закрывается: забыть его
+void store_forget(StoreManager *m, Viewer *v);
+// Следующий такт: сжатие давно не использованных, выгрузка сверх бюджета
+void store_tick(StoreManager *m);
+
+#endif